@@ -21,11 +21,15 @@
 #include "EventGraph.h"
 #include "CallTraceBuilder.h"
 #include "StringSet.h"
-#include "strutil.h"
 
+#include <assert.h>
 #include <string.h>
 #include <stdlib.h>
 
+#include <algorithm>
+#include <set>
+#include <vector>
+
 RaceTags::RaceTags(
 		const VarsInfo& races,
 		const ActionLog& log,
@@ -45,6 +49,11 @@ RaceTags::RaceTags(
 RaceTags::~RaceTags() {
 }
 
+void RaceTags::Init() {
+	m_valueTable.update(m_memValues);
+	m_initialized = true;
+}
+
 
 RaceTags::RaceTagSet RaceTags::emptyTagSet() {
 	return 0;
@@ -180,16 +189,22 @@ std::string RaceTags::getVarDefSet(int var_id) const {
 	if (it == m_races.variables().end()) return "";
 	const VarsInfo::VarData& var = it->second;
 
-	std::set<std::string> def_set;
+	// The values are distinct strings, so the set is built from their ids.
+	std::set<int> def_set;
 	for (size_t i = 0; i < var.m_accesses.size(); ++i) {
-		const char* v = getValueOfReadOrWrite(var.m_accesses[i].m_eventActionId, var.m_accesses[i].m_commandIdInEvent);
-		if (v != NULL) def_set.insert(v);
+		int v = getValueIdOfReadOrWrite(var.m_accesses[i].m_eventActionId, var.m_accesses[i].m_commandIdInEvent);
+		if (v != -1) def_set.insert(v);
 	}
+	std::vector<std::string> values;
+	for (std::set<int>::const_iterator it = def_set.begin(); it != def_set.end(); ++it) {
+		values.push_back(m_memValues.getString(*it));
+	}
+	std::sort(values.begin(), values.end());
 
 	std::string result;
-	for (std::set<std::string>::const_iterator it = def_set.begin(); it != def_set.end(); ++it) {
+	for (size_t i = 0; i < values.size(); ++i) {
 		if (!result.empty()) result += " ";
-		result += *it;
+		result += values[i];
 	}
 	return result;
 }
@@ -357,28 +372,23 @@ bool RaceTags::isCounterIncrementOrDecrementUpdate(const VarsInfo::VarData& var,
 	int write_cmd = VarsInfo::getCommandIdForVarWriteInEventAction(var, op_id);
 	if (read_cmd == -1 || write_cmd == -1) return false;
 	if (read_cmd > write_cmd) return false;
-	// Parse the read value.
-	const char* read_value = getValueOfReadOrWrite(op_id, read_cmd);
-	if (read_value == NULL) return false;
-	int read_int;
-	if (!ParseInt32(read_value, &read_int)) return false;
-	// Parse the written value.
-	const char* write_value = getValueOfReadOrWrite(op_id, write_cmd);
-	if (write_value == NULL) return false;
-	int write_int;
-	if (!ParseInt32(write_value, &write_int)) return false;
-	return abs(read_int - write_int) == 1;
+	assert(m_initialized);
+	int read_value = getValueIdOfReadOrWrite(op_id, read_cmd);
+	if (read_value == -1 || m_valueTable.kind(read_value) != MemoryValues::INT) return false;
+	int write_value = getValueIdOfReadOrWrite(op_id, write_cmd);
+	if (write_value == -1 || m_valueTable.kind(write_value) != MemoryValues::INT) return false;
+	return abs(m_valueTable.number(read_value) - m_valueTable.number(write_value)) == 1;
 }
 
 bool RaceTags::isValueTypeReadOrNull(int op_id, int cmd_id) const {
-	const char* read_value = getValueOfReadOrWrite(op_id, cmd_id);
-	if (read_value == NULL) return false;
-	int read_int;
-	if (ParseInt32(read_value, &read_int)) return true;
-	return (strcmp(read_value, "undefined") == 0 ||
-			strcmp(read_value, "NULL") == 0 ||
-			strcmp(read_value, "true") == 0 ||
-			strcmp(read_value, "false") == 0);
+	assert(m_initialized);
+	int read_value = getValueIdOfReadOrWrite(op_id, cmd_id);
+	if (read_value == -1) return false;
+	MemoryValues::Kind kind = m_valueTable.kind(read_value);
+	return (kind == MemoryValues::INT ||
+			kind == MemoryValues::UNDEFINED ||
+			kind == MemoryValues::BOOLEAN ||
+			strcmp(m_memValues.getString(read_value), "NULL") == 0);
 }
 
 bool RaceTags::isCookie(int var_id) const {
@@ -394,11 +404,17 @@ bool RaceTags::isClassName(int var_id) const {
 }
 
 const char* RaceTags::getValueOfReadOrWrite(int op_id, int cmd_id) const {
+	int value = getValueIdOfReadOrWrite(op_id, cmd_id);
+	if (value == -1) return NULL;
+	return m_memValues.getString(value);
+}
+
+int RaceTags::getValueIdOfReadOrWrite(int op_id, int cmd_id) const {
 	const ActionLog::EventAction& op = m_log.event_action(op_id);
-	if (cmd_id + 1 >= static_cast<int>(op.m_commands.size())) return NULL;
+	if (cmd_id + 1 >= static_cast<int>(op.m_commands.size())) return -1;
 	const ActionLog::Command& cmd = op.m_commands[cmd_id + 1];
-	if (cmd.m_cmdType != ActionLog::MEMORY_VALUE) return NULL;
-	return m_memValues.getString(cmd.m_location);
+	if (cmd.m_cmdType != ActionLog::MEMORY_VALUE) return -1;
+	return cmd.m_location;
 }
 
 double RaceTags::getExceptionCorruptionRiskRank(const VarsInfo::VarData& var) const {
@@ -19,6 +19,7 @@
 
 #include "base.h"
 
+#include "MemoryValues.h"
 #include "VarsInfo.h"
 #include <string>
 
@@ -36,6 +37,7 @@ public:
 			 const CallTraceBuilder& event_cause);
 	~RaceTags();
 
+	// Parses the memory values. Call after the trace is loaded.
 	void Init();
 
 	enum RaceTag {
@@ -106,6 +108,9 @@ private:
 	// Returns NULL if no such value was written (Note: the value is returned always a string
 	// and it may be the string NULL or undefined if this was the value read or written).
 	const char* getValueOfReadOrWrite(int op_id, int cmd_id) const;
+	// Same as getValueOfReadOrWrite, but returns the id of the value in the memory values
+	// or -1.
+	int getValueIdOfReadOrWrite(int op_id, int cmd_id) const;
 
 	double getExceptionCorruptionRiskRank(const VarsInfo::VarData& var) const;
 	// Number of variable write commands in an operation before the given command id.
@@ -120,6 +125,8 @@ private:
 	const StringSet& m_scopes;
 	const StringSet& m_memValues;
 	const CallTraceBuilder& m_eventCause;
+	// Empty until Init is called.
+	MemoryValues m_valueTable;
 	bool m_initialized;
 };
 
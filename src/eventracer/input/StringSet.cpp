@@ -15,9 +15,12 @@
  */
 
 #include "StringSet.h"
+#include <stdio.h>
 #include <string.h>
 
-StringSet::StringSet() : m_hashTableLoad(0) {
+#include <algorithm>
+
+StringSet::StringSet() : m_numBuiltDerivedStrings(0), m_hashTableLoad(0) {
 }
 
 int StringSet::addString(const char* s) {
@@ -25,7 +28,51 @@ int StringSet::addString(const char* s) {
 }
 
 const char* StringSet::getString(int index) const {
-	return m_data.data() + index;
+	const char* s = m_data.data() + index;
+	if (*s == 0 && m_numBuiltDerivedStrings != 0) {
+		const DerivedString* derived = findDerivedString(index);
+		if (derived != NULL) return derived->m_string.c_str();
+	}
+	return s;
+}
+
+int StringSet::addDerivedString(int base, int number) {
+	DerivedString derived;
+	derived.m_index = m_data.size();
+	derived.m_base = base;
+	derived.m_number = number;
+	m_derivedStrings.push_back(derived);
+	m_data.push_back(0);
+	return derived.m_index;
+}
+
+bool StringSet::isDerivedString(int index) const {
+	return m_data[index] == 0 && findDerivedString(index) != NULL;
+}
+
+void StringSet::materializeDerivedStrings() {
+	for (; m_numBuiltDerivedStrings < m_derivedStrings.size(); ++m_numBuiltDerivedStrings) {
+		DerivedString& derived = m_derivedStrings[m_numBuiltDerivedStrings];
+		char number[16];
+		snprintf(number, sizeof(number), "-%d", derived.m_number);
+		derived.m_string = std::string(getString(derived.m_base)) + number;
+	}
+}
+
+int StringSet::derivedStringBase(int index) const {
+	return findDerivedString(index)->m_base;
+}
+
+const StringSet::DerivedString* StringSet::findDerivedString(int index) const {
+	std::vector<DerivedString>::const_iterator it = std::lower_bound(
+			m_derivedStrings.begin(), m_derivedStrings.end(), index, DerivedStringIndexLess);
+	if (it == m_derivedStrings.end() || it->m_index != index) return NULL;
+	return &*it;
+}
+
+int StringSet::nextIndex(int index) const {
+	// A derived string takes one byte, like the empty string.
+	return index + strlen(m_data.data() + index) + 1;
 }
 
 bool StringSet::containsString(const char* s) const {
@@ -91,9 +138,11 @@ void StringSet::rehashAll() {
 	m_hashTableLoad = 0;
 	size_t pos = 0;
 	while (pos < m_data.size()) {
-		const char* str = getString(pos);
+		const char* str = m_data.data() + pos;
 		int len = strlen(str);
-		addHashNoRehash(stringHash(str, len), pos);
+		if (len != 0 || findDerivedString(pos) == NULL) {
+			addHashNoRehash(stringHash(str, len), pos);
+		}
 		pos += len + 1;
 	}
 }
@@ -112,6 +161,8 @@ bool StringSet::loadFromFile(FILE* f) {
 	m_data.resize(n, 0);
 	if (fread(m_data.data(), sizeof(char), n, f) != m_data.size()) return false;
 	if (fread(&n, sizeof(int), 1, f) != 1) return false;
+	m_derivedStrings.clear();
+	m_numBuiltDerivedStrings = 0;
 	m_hashes.assign(n, -1);
 	rehashAll();
 	return true;
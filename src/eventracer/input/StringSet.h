@@ -18,6 +18,7 @@
 #define STRINGSET_H_
 
 #include <stdio.h>
+#include <string>
 #include <vector>
 
 class StringSet {
@@ -27,6 +28,18 @@ public:
 	// Returns the index of the added string.
 	int addString(const char* s);
 
+	// Adds the string "<base string>-<number>" without building it. The string gets a new
+	// index even if the set already contains it, and findString does not find it. Until
+	// materializeDerivedStrings is called, getString returns an empty string for it.
+	// saveToFile stores it as an empty string.
+	int addDerivedString(int base, int number);
+	// Builds the derived strings added since the last call, so that getString returns them.
+	// Call it before the set is read from several threads; getString does not modify the set.
+	void materializeDerivedStrings();
+	bool isDerivedString(int index) const;
+	// The base of a string added with addDerivedString.
+	int derivedStringBase(int index) const;
+
 	// Returns the string for an index. The returned pointer is guaranteed
 	// to be valid only until the next modification of StringSet.
 	const char* getString(int index) const;
@@ -43,8 +56,13 @@ public:
 	// Loads the string set from a file.
 	bool loadFromFile(FILE* f);
 
-	// The number of entries in the string set.
-	int numEntries() const { return m_hashTableLoad; }
+	// The number of entries in the string set, including the derived strings.
+	int numEntries() const { return m_hashTableLoad + m_derivedStrings.size(); }
+
+	// The strings are stored one after another at the indices below endIndex(). Returns
+	// the index of the string after the one at index.
+	int nextIndex(int index) const;
+	int endIndex() const { return m_data.size(); }
 
 private:
 	// Returns the index of the added string.
@@ -62,7 +80,24 @@ private:
 
 	void rehashAll();
 
+	struct DerivedString {
+		int m_index;
+		int m_base;
+		int m_number;
+		// Empty until built by materializeDerivedStrings.
+		std::string m_string;
+	};
+	static bool DerivedStringIndexLess(const DerivedString& a, int index) {
+		return a.m_index < index;
+	}
+	// NULL if the string at index is not derived.
+	const DerivedString* findDerivedString(int index) const;
+
 	std::vector<char> m_data;
+	// A derived string has one zero byte in m_data. They are in the order of their indices.
+	std::vector<DerivedString> m_derivedStrings;
+	// The number of m_derivedStrings built by materializeDerivedStrings.
+	size_t m_numBuiltDerivedStrings;
 	std::vector<int> m_hashes;
 	int m_hashTableLoad;
 };
@@ -0,0 +1,91 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "AnalysisProgress.h"
+
+#include <stdio.h>
+
+// Minimum time between two progress messages.
+static const int64 kPrintIntervalMicros = 5000000;
+
+AnalysisProgress::AnalysisProgress()
+	: m_doneWork(0), m_numUpdates(0), m_stopped(false), m_lastPrintTime(0),
+	  m_stageStartTime(0), m_totalWork(0), m_reportedWork(0), m_deadline(0),
+	  m_cancelled(false), m_timedOut(false) {
+}
+
+void AnalysisProgress::startStage(const char* name, int64 total_work) {
+	int64 now = GetCurrentTimeMicros();
+	m_doneWork = 0;
+	m_numUpdates = 0;
+	m_lastPrintTime = now;
+	lock_guard<mutex> lock(m_mutex);
+	m_stage = name;
+	m_stageStartTime = now;
+	m_totalWork = total_work;
+	m_reportedWork = 0;
+}
+
+void AnalysisProgress::setDeadline(int64 deadline_micros) {
+	m_stopped = false;
+	lock_guard<mutex> lock(m_mutex);
+	m_deadline = deadline_micros;
+	m_timedOut = false;
+}
+
+void AnalysisProgress::cancel() {
+	lock_guard<mutex> lock(m_mutex);
+	m_cancelled = true;
+}
+
+bool AnalysisProgress::checkStatus() {
+	m_numUpdates = 0;
+	int64 now = GetCurrentTimeMicros();
+	bool print = now - m_lastPrintTime > kPrintIntervalMicros;
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_reportedWork = m_doneWork;
+		if (m_deadline != 0 && now > m_deadline) {
+			m_timedOut = true;
+		}
+		m_stopped = m_cancelled || m_timedOut;
+	}
+	if (print) {
+		m_lastPrintTime = now;
+		Status s = status();
+		printf("%s: %.1f%% done, %lld ms remaining.\n", s.m_stage.c_str(), s.m_fraction * 100, s.m_remainingMs);
+	}
+	return !m_stopped;
+}
+
+AnalysisProgress::Status AnalysisProgress::status() const {
+	int64 now = GetCurrentTimeMicros();
+	lock_guard<mutex> lock(m_mutex);
+	Status result;
+	result.m_stage = m_stage;
+	result.m_fraction = 0;
+	result.m_remainingMs = -1;
+	if (m_totalWork > 0) {
+		result.m_fraction = static_cast<double>(m_reportedWork) / m_totalWork;
+	}
+	if (m_reportedWork > 0) {
+		double elapsed_ms = (now - m_stageStartTime) / 1000.0;
+		result.m_remainingMs = static_cast<int64>(elapsed_ms * (m_totalWork - m_reportedWork) / m_reportedWork);
+	}
+	result.m_cancelled = m_cancelled;
+	result.m_timedOut = m_timedOut;
+	return result;
+}
@@ -0,0 +1,90 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef ANALYSISPROGRESS_H_
+#define ANALYSISPROGRESS_H_
+
+#include <string>
+
+#include "base.h"
+#include "mutex.h"
+
+// Progress of a long running analysis that consists of several stages.
+//
+// The analysis reports how much of the current stage is done and stops when
+// update returns false. This happens when the deadline passes or when another
+// thread cancels the analysis. The status can be read from any thread.
+class AnalysisProgress {
+public:
+	AnalysisProgress();
+
+	// Starts a new stage of the analysis with total_work units of work.
+	void startStage(const char* name, int64 total_work);
+
+	// Sets the number of done units of work in the current stage. Returns false if
+	// the analysis must stop. Cheap enough to be called for every unit of work, but
+	// only checks the deadline and the cancellation once every 1024 calls.
+	bool update(int64 done_work) {
+		m_doneWork = done_work;
+		if (++m_numUpdates < 1024) return !m_stopped;
+		return checkStatus();
+	}
+
+	// Same as update, but always checks if the analysis must stop. To be used for
+	// larger units of work.
+	bool check(int64 done_work) {
+		m_doneWork = done_work;
+		return checkStatus();
+	}
+
+	// Sets the time (as returned by GetCurrentTimeMicros) after which the analysis stops.
+	// Zero means no deadline.
+	void setDeadline(int64 deadline_micros);
+
+	// Asks the analysis to stop. Can be called from any thread.
+	void cancel();
+
+	struct Status {
+		std::string m_stage;
+		// Done fraction of the current stage between 0 and 1.
+		double m_fraction;
+		// Estimated time to finish the current stage or -1 if unknown.
+		int64 m_remainingMs;
+		bool m_cancelled;
+		bool m_timedOut;
+	};
+	Status status() const;
+
+private:
+	bool checkStatus();
+
+	// Only used by the analysis thread.
+	int64 m_doneWork;
+	int m_numUpdates;
+	bool m_stopped;
+	int64 m_lastPrintTime;
+
+	mutable mutex m_mutex;
+	std::string m_stage;
+	int64 m_stageStartTime;
+	int64 m_totalWork;
+	int64 m_reportedWork;
+	int64 m_deadline;
+	bool m_cancelled;
+	bool m_timedOut;
+};
+
+#endif /* ANALYSISPROGRESS_H_ */
@@ -18,48 +18,79 @@
 
 #include <stdio.h>
 
+#include <algorithm>
+
+#include "AnalysisProgress.h"
 #include "base.h"
 
 
 BitClocks::BitClocks() {
 }
 
-void BitClocks::build(const SimpleDirectedGraph& graph) {
-	int nodes = graph.numNodes();
-	std::vector<unsigned int> empty((nodes + 31) / 32, 0);
-	m_bitClocks.assign(nodes, empty);
-	computeBitClocks(graph);
+void BitClocks::build(const SimpleDirectedGraph& graph, AnalysisProgress* progress) {
+	m_denseId.clear();
+	m_bitClocks.clear();
+	addClocks(graph, 0);
+	computeBitClocks(graph, 0, progress);
+}
+
+void BitClocks::extend(const SimpleDirectedGraph& graph, int first_new_node) {
+	addClocks(graph, first_new_node);
+	computeBitClocks(graph, first_new_node, NULL);
+}
+
+void BitClocks::addClocks(const SimpleDirectedGraph& graph, int first_node) {
+	int num_clocks = m_bitClocks.size();
+	m_denseId.resize(graph.numNodes(), -1);
+	for (int node_id = first_node; node_id < graph.numNodes(); ++node_id) {
+		m_denseId[node_id] = graph.isNodeDeleted(node_id) ? -1 : num_clocks++;
+	}
+	std::vector<unsigned int> empty((num_clocks + 31) / 32, 0);
+	m_bitClocks.resize(num_clocks, empty);
 }
 
-void BitClocks::computeBitClocks(const SimpleDirectedGraph& graph) {
+void BitClocks::computeBitClocks(const SimpleDirectedGraph& graph, int first_node, AnalysisProgress* progress) {
 	printf("Computing BitClocks...\n");
 	int64 start_time = GetCurrentTimeMicros();
+	if (progress != NULL) progress->startStage("Bit vector clocks", graph.numNodes() - first_node);
 
-	for (int node_id = 0; node_id < graph.numNodes(); ++node_id) {
-		std::vector<unsigned int>& cl = m_bitClocks[node_id];
+	for (int node_id = first_node; node_id < graph.numNodes(); ++node_id) {
+		if (progress != NULL && !progress->update(node_id - first_node)) break;
+		int id = m_denseId[node_id];
+		if (id < 0) continue;
+		std::vector<unsigned int>& cl = m_bitClocks[id];
 
 		const std::vector<int>& pred = graph.nodePredecessors(node_id);
 		for (size_t j = 0; j < pred.size(); ++j) {
-			for (size_t i = 0; i < cl.size(); ++i) {
-				cl[i] |= m_bitClocks[pred[j]][i];
+			// Nodes added by an earlier extend have narrower clocks.
+			const std::vector<unsigned int>& pred_cl = m_bitClocks[m_denseId[pred[j]]];
+			size_t size = std::min(cl.size(), pred_cl.size());
+			for (size_t i = 0; i < size; ++i) {
+				cl[i] |= pred_cl[i];
 			}
 		}
-		cl[node_id / 32] |= 1u << (node_id % 32);
+		cl[id / 32] |= 1u << (id % 32);
 	}
 	printf("Computing BitClocks done... (%lld ms)\n", (GetCurrentTimeMicros() - start_time) / 1000);
 }
 
-bool BitClocks::areOrdered(int slice1, int slice2) const {
-	if (slice1 < 0 ||
-		slice2 < 0 ||
-		slice1 >= static_cast<int>(m_bitClocks.size()) ||
-		slice2 >= static_cast<int>(m_bitClocks.size())) return false;
-
-	if (slice1 == slice2) return true;
+size_t BitClocks::memoryBytes() const {
+	size_t bytes = m_denseId.capacity() * sizeof(int) +
+			m_bitClocks.capacity() * sizeof(std::vector<unsigned int>);
+	for (size_t i = 0; i < m_bitClocks.size(); ++i) {
+		bytes += m_bitClocks[i].capacity() * sizeof(unsigned int);
+	}
+	return bytes;
+}
 
-	int a1 = (m_bitClocks[slice1][slice1 / 32] >> (slice1 % 32)) & 1;
-	int a2 = (m_bitClocks[slice2][slice1 / 32] >> (slice1 % 32)) & 1;
-	return a1 <= a2;
+void BitClocks::areOrderedBatch(const std::vector<OrderQuery>& queries, std::vector<bool>* ordered) const {
+	ordered->resize(queries.size());
+	std::vector<int> order;
+	sortQueriesByTarget(queries, &order);
+	for (size_t i = 0; i < order.size(); ++i) {
+		const OrderQuery& query = queries[order[i]];
+		(*ordered)[order[i]] = isOrdered(query.first, query.second);
+	}
 }
 
 
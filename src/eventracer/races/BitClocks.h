@@ -20,18 +20,53 @@
 #include <vector>
 #include "EventGraph.h"
 
+class AnalysisProgress;
+
 // Computes happens before using vector clocks of width |num_nodes|, but with optimized storage for
 // one bit per vector clock value (such vector clocks may have values only of 0 and 1).
+// Clocks of nodes added by extend are wider than the clocks of the older nodes.
+// The deleted nodes of the graph get no clock and no bit, the other nodes are numbered densely.
 class BitClocks : public EventGraphInterface {
 public:
 	BitClocks();
-	void build(const SimpleDirectedGraph& graph);
+	// Reports to progress (if not NULL) and stops early if the analysis must stop.
+	// The result is not usable in this case.
+	void build(const SimpleDirectedGraph& graph, AnalysisProgress* progress = NULL);
+
+	virtual bool areOrdered(int slice1, int slice2) const {
+		return isOrdered(slice1, slice2);
+	}
+	// Answers the queries in the order of their targets, reading every clock once.
+	virtual void areOrderedBatch(const std::vector<OrderQuery>& queries, std::vector<bool>* ordered) const;
+	virtual void extend(const SimpleDirectedGraph& graph, int first_new_node);
+	// The memory allocated for the clocks.
+	size_t memoryBytes() const;
+
+	// Same as areOrdered, but inlined into the loops that are templated on the backend.
+	bool isOrdered(int slice1, int slice2) const {
+		if (slice1 < 0 ||
+			slice2 < 0 ||
+			slice1 >= static_cast<int>(m_denseId.size()) ||
+			slice2 >= static_cast<int>(m_denseId.size())) return false;
+
+		if (slice1 == slice2) return true;
+		int id1 = m_denseId[slice1];
+		int id2 = m_denseId[slice2];
+		if (id1 < 0 || id2 < 0) return false;
+		if (id1 / 32 >= static_cast<int>(m_bitClocks[id2].size())) return false;
 
-	virtual bool areOrdered(int slice1, int slice2) const;
+		int a1 = (m_bitClocks[id1][id1 / 32] >> (id1 % 32)) & 1;
+		int a2 = (m_bitClocks[id2][id1 / 32] >> (id1 % 32)) & 1;
+		return a1 <= a2;
+	}
 
 private:
-	void computeBitClocks(const SimpleDirectedGraph& graph);
+	// Numbers the nodes with id >= first_node that are not deleted and adds their clocks.
+	void addClocks(const SimpleDirectedGraph& graph, int first_node);
+	void computeBitClocks(const SimpleDirectedGraph& graph, int first_node, AnalysisProgress* progress);
 
+	// The index of the clock and of the clock bit of every node, -1 for the deleted nodes.
+	std::vector<int> m_denseId;
 	std::vector<std::vector<unsigned int> > m_bitClocks;
 };
 
@@ -0,0 +1,132 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "ConnectivityModel.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+#include "EventGraph.h"
+
+namespace {
+// Costs in nanoseconds, calibrated on generated traces with 2500 and 6000 event actions.
+// ThreadMapping::computeVectorClocks: one vector clock entry of a node or an arc.
+const double kCDNanosPerEntry = 1.0;
+// BitClocks::computeBitClocks: one 32-bit word of a node or an arc.
+const double kBVCNanosPerWord = 2.0;
+// The race detection and the race coverage per access, with the queries answered from
+// vector clocks.
+const double kClockNanosPerQuery = 15000.0;
+// The same with breadth-first search, per access and per node or arc of the graph.
+const double kBFSNanosPerQueryNode = 200.0;
+
+const char* const kAlgorithms[] = { "CD", "BVC", "BFS" };
+const int kNumAlgorithms = 3;
+}  // namespace
+
+ConnectivityModel::ConnectivityModel(const SimpleDirectedGraph& graph, int64 num_queries)
+	: m_numNodes(graph.numNodes()), m_numLiveNodes(0), m_numArcs(0), m_numChains(0), m_depth(0),
+	  m_numQueries(num_queries) {
+	// A chain continues to the first successor that no other chain continues to, as in the
+	// greedy pass of ThreadMapping. Every node that is not continued to starts a new chain.
+	std::vector<bool> continued(m_numNodes, false);
+	std::vector<int> depth(m_numNodes, 0);
+	for (int node_id = 0; node_id < m_numNodes; ++node_id) {
+		if (graph.isNodeDeleted(node_id)) continue;
+		++m_numLiveNodes;
+		if (!continued[node_id]) ++m_numChains;
+		const std::vector<int>& succ = graph.nodeSuccessors(node_id);
+		m_numArcs += succ.size();
+		for (size_t i = 0; i < succ.size(); ++i) {
+			if (!continued[succ[i]]) {
+				continued[succ[i]] = true;
+				break;
+			}
+		}
+		const std::vector<int>& pred = graph.nodePredecessors(node_id);
+		for (size_t i = 0; i < pred.size(); ++i) {
+			depth[node_id] = std::max(depth[node_id], depth[pred[i]]);
+		}
+		++depth[node_id];
+		m_depth = std::max(m_depth, depth[node_id]);
+	}
+}
+
+int64 ConnectivityModel::predictedMemoryBytes(const std::string& algorithm) const {
+	int64 n = m_numNodes;
+	// The graph itself, kept in both directions.
+	int64 graph_bytes = n * 2 * sizeof(std::vector<int>) + m_numArcs * 2 * sizeof(int);
+	if (algorithm == "CD") {
+		return n * (sizeof(std::vector<short>) + m_numChains * sizeof(short) + sizeof(int));
+	} else if (algorithm == "BVC") {
+		int64 live = m_numLiveNodes;
+		return n * sizeof(int) +
+				live * (sizeof(std::vector<unsigned int>) + (live + 31) / 32 * sizeof(unsigned int));
+	}
+	return graph_bytes;
+}
+
+double ConnectivityModel::predictedBuildTimeMs(const std::string& algorithm) const {
+	double arcs_and_nodes = static_cast<double>(m_numArcs) + m_numNodes;
+	if (algorithm == "CD") {
+		return arcs_and_nodes * m_numChains * kCDNanosPerEntry / 1000000;
+	} else if (algorithm == "BVC") {
+		return arcs_and_nodes * ((m_numLiveNodes + 31) / 32) * kBVCNanosPerWord / 1000000;
+	}
+	return 0;
+}
+
+double ConnectivityModel::predictedTimeMs(const std::string& algorithm) const {
+	double query_nanos;
+	if (algorithm == "BFS") {
+		query_nanos = (static_cast<double>(m_numArcs) + m_numNodes) * kBFSNanosPerQueryNode;
+	} else {
+		query_nanos = kClockNanosPerQuery;
+	}
+	return predictedBuildTimeMs(algorithm) + m_numQueries * query_nanos / 1000000;
+}
+
+std::string ConnectivityModel::choose(int64 max_memory_bytes) const {
+	std::string best = "BFS";
+	for (int i = 0; i < kNumAlgorithms; ++i) {
+		std::string algorithm = kAlgorithms[i];
+		if (predictedMemoryBytes(algorithm) > max_memory_bytes) continue;
+		if (predictedTimeMs(algorithm) < predictedTimeMs(best)) {
+			best = algorithm;
+		}
+	}
+	return best;
+}
+
+void ConnectivityModel::printPredictions() const {
+	printf("Connectivity model: %d nodes, %lld arcs, about %d chains, depth %d, %lld queries.\n",
+			m_numNodes, m_numArcs, m_numChains, m_depth, m_numQueries);
+	for (int i = 0; i < kNumAlgorithms; ++i) {
+		printf("  %s: predicted %.0f ms to build, %.0f ms in total, %lld MB\n", kAlgorithms[i],
+				predictedBuildTimeMs(kAlgorithms[i]), predictedTimeMs(kAlgorithms[i]),
+				predictedMemoryBytes(kAlgorithms[i]) >> 20);
+	}
+}
+
+void ConnectivityModel::printActual(const std::string& algorithm, int64 build_time_ms, int64 total_time_ms,
+		int64 memory_bytes) const {
+	printf("Connectivity model: %s predicted %.0f ms to build, %.0f ms in total and %lld MB, "
+			"actual %lld ms to build, %lld ms in total and %lld MB.\n",
+			algorithm.c_str(), predictedBuildTimeMs(algorithm), predictedTimeMs(algorithm),
+			predictedMemoryBytes(algorithm) >> 20,
+			build_time_ms, total_time_ms, memory_bytes >> 20);
+}
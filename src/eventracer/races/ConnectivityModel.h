@@ -0,0 +1,66 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef CONNECTIVITYMODEL_H_
+#define CONNECTIVITYMODEL_H_
+
+#include <string>
+#include "base.h"
+
+class SimpleDirectedGraph;
+
+// Predicts the build time and the memory of the connectivity algorithms (CD, BVC and BFS)
+// from cheap statistics of the graph and chooses the fastest one that fits in memory.
+class ConnectivityModel {
+public:
+	// Computes the statistics in O(nodes + arcs). num_queries is the expected number of
+	// connectivity queries of the race detection, about one per access.
+	ConnectivityModel(const SimpleDirectedGraph& graph, int64 num_queries);
+
+	// Returns the algorithm with the smallest predicted time with at most max_memory_bytes
+	// of memory, or BFS if no other algorithm fits.
+	std::string choose(int64 max_memory_bytes) const;
+
+	// The predicted time to build an algorithm, the predicted time including the race
+	// detection and the predicted memory.
+	double predictedBuildTimeMs(const std::string& algorithm) const;
+	double predictedTimeMs(const std::string& algorithm) const;
+	int64 predictedMemoryBytes(const std::string& algorithm) const;
+
+	// Logs the statistics and the predictions for all the algorithms.
+	void printPredictions() const;
+
+	// Logs the prediction for the chosen algorithm next to the actual cost. memory_bytes is
+	// the memory allocated by the built backend.
+	void printActual(const std::string& algorithm, int64 build_time_ms, int64 total_time_ms,
+			int64 memory_bytes) const;
+
+	int numChains() const { return m_numChains; }
+	int depth() const { return m_depth; }
+
+private:
+	int m_numNodes;
+	// The nodes that are not deleted, which are the only ones with bit vector clocks.
+	int m_numLiveNodes;
+	int64 m_numArcs;
+	// The estimated number of chains of a chain decomposition.
+	int m_numChains;
+	// The number of nodes on the longest path.
+	int m_depth;
+	int64 m_numQueries;
+};
+
+#endif /* CONNECTIVITYMODEL_H_ */
@@ -16,37 +16,235 @@
 
 #include "EventGraph.h"
 
+#include "AnalysisProgress.h"
+#include "ReachabilityCache.h"
+
+#include <algorithm>
+#include <functional>
 
 EventGraphInterface::~EventGraphInterface() {
 }
 
+void EventGraphInterface::areOrderedBatch(const std::vector<OrderQuery>& queries, std::vector<bool>* ordered) const {
+	ordered->resize(queries.size());
+	for (size_t i = 0; i < queries.size(); ++i) {
+		(*ordered)[i] = areOrdered(queries[i].first, queries[i].second);
+	}
+}
+
+namespace {
+// Orders query indices by (target, source) or by (source, target) of the queries.
+class QueryIndexLess {
+public:
+	QueryIndexLess(const std::vector<EventGraphInterface::OrderQuery>& queries, bool by_source)
+		: m_queries(queries), m_bySource(by_source) {
+	}
+
+	bool operator()(int a, int b) const {
+		const EventGraphInterface::OrderQuery& qa = m_queries[a];
+		const EventGraphInterface::OrderQuery& qb = m_queries[b];
+		if (m_bySource) return qa < qb;
+		if (qa.second != qb.second) return qa.second < qb.second;
+		return qa.first < qb.first;
+	}
+
+private:
+	const std::vector<EventGraphInterface::OrderQuery>& m_queries;
+	bool m_bySource;
+};
+}  // namespace
+
+void EventGraphInterface::sortQueriesByTarget(const std::vector<OrderQuery>& queries, std::vector<int>* order) {
+	order->resize(queries.size());
+	bool increasing = true, decreasing = true;
+	for (size_t i = 0; i < queries.size(); ++i) {
+		(*order)[i] = i;
+		if (i > 0) {
+			increasing = increasing && queries[i - 1].second <= queries[i].second;
+			decreasing = decreasing && queries[i - 1].second >= queries[i].second;
+		}
+	}
+	if (!increasing && !decreasing) {
+		std::sort(order->begin(), order->end(), QueryIndexLess(queries, false));
+	}
+}
+
 
-SimpleDirectedGraph::SimpleDirectedGraph() {
+SimpleDirectedGraph::SimpleDirectedGraph() : m_queryCache(NULL) {
 	addNode();  // Node 0 doesn't exist.
 }
 
+SimpleDirectedGraph::SimpleDirectedGraph(const SimpleDirectedGraph& other)
+    : m_nodes(other.m_nodes), m_queryCache(NULL) {
+}
+
+SimpleDirectedGraph& SimpleDirectedGraph::operator=(const SimpleDirectedGraph& other) {
+	if (this != &other) {
+		m_nodes = other.m_nodes;
+		setQueryCacheSize(0);
+	}
+	return *this;
+}
+
+SimpleDirectedGraph::~SimpleDirectedGraph() {
+	delete m_queryCache;
+}
+
+void SimpleDirectedGraph::createEmptyGraph(int node_count) {
+	m_nodes.assign(node_count, Node());
+	if (m_queryCache != NULL) m_queryCache->clear();
+}
+
+void SimpleDirectedGraph::setQueryCacheSize(int max_sources) {
+	delete m_queryCache;
+	m_queryCache = max_sources > 0 ? new ReachabilityCache(max_sources) : NULL;
+}
+
 void SimpleDirectedGraph::addArc(int source, int target) {
-	if (source == target) return;
+	if (source == target || hasArc(source, target)) return;
+	if (m_queryCache != NULL) m_queryCache->addArc(source, target);
 	Node& node = m_nodes[source];
-	for (size_t i = 0; i < node.m_successors.size(); ++i) {
-		if (node.m_successors[i] == target) return;
-	}
 	node.m_successors.push_back(target);
+	addSortedSuccessor(&node, target);
 	m_nodes[target].m_predecessors.push_back(source);
 }
 
+void SimpleDirectedGraph::addArcs(const std::vector<std::pair<int, int> >& arcs) {
+	std::vector<int> order(arcs.size());
+	for (size_t i = 0; i < arcs.size(); ++i) {
+		order[i] = i;
+	}
+	// The first copy of every arc comes first among the equal arcs.
+	std::stable_sort(order.begin(), order.end(), QueryIndexLess(arcs, true));
+	std::vector<bool> is_new(arcs.size(), false);
+	std::vector<int> num_new_successors(m_nodes.size(), 0);
+	std::vector<int> num_new_predecessors(m_nodes.size(), 0);
+	for (size_t k = 0; k < order.size(); ++k) {
+		const std::pair<int, int>& arc = arcs[order[k]];
+		if (arc.first == arc.second || (k > 0 && arcs[order[k - 1]] == arc) ||
+				hasArc(arc.first, arc.second)) continue;
+		is_new[order[k]] = true;
+		++num_new_successors[arc.first];
+		++num_new_predecessors[arc.second];
+	}
+	for (size_t i = 0; i < m_nodes.size(); ++i) {
+		m_nodes[i].m_successors.reserve(m_nodes[i].m_successors.size() + num_new_successors[i]);
+		m_nodes[i].m_predecessors.reserve(m_nodes[i].m_predecessors.size() + num_new_predecessors[i]);
+	}
+	for (size_t i = 0; i < arcs.size(); ++i) {
+		if (!is_new[i]) continue;
+		m_nodes[arcs[i].first].m_successors.push_back(arcs[i].second);
+		m_nodes[arcs[i].second].m_predecessors.push_back(arcs[i].first);
+	}
+	for (size_t i = 0; i < m_nodes.size(); ++i) {
+		Node& node = m_nodes[i];
+		if (num_new_successors[i] > 0 && node.m_successors.size() >= kSortedSuccessorsDegree) {
+			node.m_sortedSuccessors = node.m_successors;
+			std::sort(node.m_sortedSuccessors.begin(), node.m_sortedSuccessors.end());
+		}
+	}
+	if (m_queryCache != NULL) m_queryCache->clear();
+}
+
+int SimpleDirectedGraph::removeTransitiveArcs(AnalysisProgress* progress) {
+	// The sources are checked in blocks of 64 nodes. A sweep over the later nodes sets
+	// reach[x] to the mask of the block nodes with a path to x. An arc p -> x is implied
+	// by another path if p reaches another predecessor of x. The sweep stops at the last
+	// target of the arcs from the block.
+	int num_nodes = m_nodes.size();
+	std::vector<unsigned long long> reach(num_nodes, 0);
+	std::vector<std::pair<int, int> > transitive;
+	if (progress != NULL) progress->startStage("Transitive reduction", num_nodes);
+	for (int block = 0; block < num_nodes; block += 64) {
+		if (progress != NULL && !progress->update(block)) break;
+		int block_end = std::min(block + 64, num_nodes);
+		int last = block_end - 1;
+		for (int x = block; x < block_end; ++x) {
+			const std::vector<int>& succ = m_nodes[x].m_successors;
+			for (size_t j = 0; j < succ.size(); ++j) {
+				last = std::max(last, succ[j]);
+			}
+		}
+		for (int x = block; x <= last; ++x) {
+			unsigned long long direct = 0, via = 0;
+			const std::vector<int>& pred = m_nodes[x].m_predecessors;
+			for (size_t j = 0; j < pred.size(); ++j) {
+				int p = pred[j];
+				if (p >= x || p < block) continue;
+				via |= reach[p];
+				if (p < block_end) direct |= 1ULL << (p - block);
+			}
+			reach[x] = via | direct;
+			if ((via & direct) != 0) {
+				for (size_t j = 0; j < pred.size(); ++j) {
+					int p = pred[j];
+					if (p < x && p >= block && p < block_end && ((via >> (p - block)) & 1) != 0) {
+						transitive.push_back(std::pair<int, int>(p, x));
+					}
+				}
+			}
+		}
+		std::fill(reach.begin() + block, reach.begin() + last + 1, 0);
+	}
+	if (transitive.empty()) return 0;
+
+	std::sort(transitive.begin(), transitive.end());
+	for (int i = 0; i < num_nodes; ++i) {
+		Node& node = m_nodes[i];
+		size_t num_succ = 0;
+		for (size_t j = 0; j < node.m_successors.size(); ++j) {
+			int target = node.m_successors[j];
+			if (target > i && std::binary_search(
+					transitive.begin(), transitive.end(), std::pair<int, int>(i, target))) continue;
+			node.m_successors[num_succ++] = target;
+		}
+		if (num_succ != node.m_successors.size()) {
+			node.m_successors.resize(num_succ);
+			node.m_sortedSuccessors.clear();
+			if (node.m_successors.size() >= kSortedSuccessorsDegree) {
+				node.m_sortedSuccessors = node.m_successors;
+				std::sort(node.m_sortedSuccessors.begin(), node.m_sortedSuccessors.end());
+			}
+		}
+		size_t num_pred = 0;
+		for (size_t j = 0; j < node.m_predecessors.size(); ++j) {
+			int source = node.m_predecessors[j];
+			if (source < i && std::binary_search(
+					transitive.begin(), transitive.end(), std::pair<int, int>(source, i))) continue;
+			node.m_predecessors[num_pred++] = source;
+		}
+		node.m_predecessors.resize(num_pred);
+	}
+	if (m_queryCache != NULL) m_queryCache->clear();
+	return transitive.size();
+}
+
+void SimpleDirectedGraph::addSortedSuccessor(Node* node, int target) {
+	if (!node->m_sortedSuccessors.empty()) {
+		node->m_sortedSuccessors.insert(
+				std::lower_bound(node->m_sortedSuccessors.begin(), node->m_sortedSuccessors.end(), target),
+				target);
+	} else if (node->m_successors.size() >= kSortedSuccessorsDegree) {
+		node->m_sortedSuccessors = node->m_successors;
+		std::sort(node->m_sortedSuccessors.begin(), node->m_sortedSuccessors.end());
+	}
+}
+
 bool SimpleDirectedGraph::addArcIfNeeded(int source, int target) {
-	if (areOrdered(source, target)) return false;
+	if (isOrdered(source, target)) return false;
 	addArc(source, target);
 	return true;
 }
 
 void SimpleDirectedGraph::deleteArc(int source, int target) {
+	if (!hasArc(source, target)) return;
+	if (m_queryCache != NULL) m_queryCache->clear();
 	deleteArcFromPredecessors(source, target);
 	deleteArcFromSuccessors(source, target);
 }
 
-bool SimpleDirectedGraph::areOrdered(int source, int target) const {
+bool SimpleDirectedGraph::isOrdered(int source, int target) const {
+	if (m_queryCache != NULL) return m_queryCache->isOrdered(*this, source, target);
 	SimpleDirectedGraph::BFIterator it(*this, 0x3fffffff, true);
 	it.addNode(source);
 	int node;
@@ -59,6 +257,119 @@ bool SimpleDirectedGraph::areOrdered(int source, int target) const {
 	return false;
 }
 
+void SimpleDirectedGraph::areOrderedBatch(const std::vector<OrderQuery>& queries, std::vector<bool>* ordered) const {
+	ordered->resize(queries.size());
+	if (m_queryCache != NULL) {
+		for (size_t i = 0; i < queries.size(); ++i) {
+			(*ordered)[i] = m_queryCache->isOrdered(*this, queries[i].first, queries[i].second);
+		}
+		return;
+	}
+	std::vector<int> order(queries.size());
+	for (size_t i = 0; i < queries.size(); ++i) {
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), QueryIndexLess(queries, true));
+
+	// Queries from one source share a search, which is extended for the targets of the
+	// source in increasing order.
+	for (size_t group_start = 0; group_start < order.size();) {
+		int source = queries[order[group_start]].first;
+		ReachableSet reachable(source);
+		size_t i = group_start;
+		for (; i < order.size() && queries[order[i]].first == source; ++i) {
+			int target = queries[order[i]].second;
+			(*ordered)[order[i]] = reachable.isOrdered(*this, target);
+		}
+		group_start = i;
+	}
+}
+
+void SimpleDirectedGraph::areOrderedMulti(const std::vector<int>& sources, const std::vector<int>& targets,
+		bool avoid_sources, std::vector<bool>* ordered) const {
+	ordered->assign(sources.size() * targets.size(), false);
+	std::vector<int> sorted_targets(targets);
+	std::sort(sorted_targets.begin(), sorted_targets.end());
+	sorted_targets.erase(std::unique(sorted_targets.begin(), sorted_targets.end()), sorted_targets.end());
+
+	std::vector<unsigned long long> target_masks;
+	for (size_t first = 0; first < sources.size(); first += 64) {
+		std::vector<int> chunk(sources.begin() + first, sources.begin() + std::min(first + 64, sources.size()));
+		findSourceMasks(chunk, sorted_targets, avoid_sources, &target_masks);
+		for (size_t j = 0; j < targets.size(); ++j) {
+			unsigned long long mask = target_masks[
+					std::lower_bound(sorted_targets.begin(), sorted_targets.end(), targets[j]) - sorted_targets.begin()];
+			for (size_t k = 0; k < chunk.size(); ++k) {
+				(*ordered)[(first + k) * targets.size() + j] = ((mask >> k) & 1) != 0;
+			}
+		}
+	}
+}
+
+void SimpleDirectedGraph::findSourceMasks(const std::vector<int>& sources, const std::vector<int>& sorted_targets,
+		bool avoid_sources, std::vector<unsigned long long>* target_masks) const {
+	// Like in areOrdered, a path to a target may only go through nodes before the target.
+	// The sweep expands the nodes in increasing order and reads the mask of every target
+	// once all the nodes before it are expanded.
+	std::vector<unsigned long long> visited(m_nodes.size(), 0);
+	std::vector<unsigned long long> expanded(m_nodes.size(), 0);
+	std::vector<unsigned long long> own;
+	if (avoid_sources) own.assign(m_nodes.size(), 0);
+	// Min-heap of the nodes with sources that are not expanded yet.
+	std::vector<int> pending;
+	for (size_t k = 0; k < sources.size(); ++k) {
+		visited[sources[k]] |= 1ULL << k;
+		if (avoid_sources) own[sources[k]] |= 1ULL << k;
+		pending.push_back(sources[k]);
+	}
+	std::make_heap(pending.begin(), pending.end(), std::greater<int>());
+
+	target_masks->resize(sorted_targets.size());
+	for (size_t j = 0; j < sorted_targets.size(); ++j) {
+		int target = sorted_targets[j];
+		while (!pending.empty() && pending.front() < target) {
+			int node = pending.front();
+			std::pop_heap(pending.begin(), pending.end(), std::greater<int>());
+			pending.pop_back();
+			unsigned long long bits = visited[node] & ~expanded[node];
+			expanded[node] |= bits;
+			// The paths of the other sources stop at a source.
+			if (avoid_sources && own[node] != 0) bits &= own[node];
+			if (bits == 0) continue;
+			const std::vector<int>& next = m_nodes[node].m_successors;
+			for (size_t i = 0; i < next.size(); ++i) {
+				unsigned long long new_bits = bits & ~visited[next[i]];
+				if (new_bits == 0) continue;
+				visited[next[i]] |= new_bits;
+				pending.push_back(next[i]);
+				std::push_heap(pending.begin(), pending.end(), std::greater<int>());
+			}
+		}
+		(*target_masks)[j] = visited[target];
+	}
+}
+
+void SimpleDirectedGraph::extend(const SimpleDirectedGraph& graph, int first_new_node) {
+	addNodesUpTo(graph.numNodes() - 1);
+	for (int node_id = first_new_node; node_id < graph.numNodes(); ++node_id) {
+		m_nodes[node_id].m_deleted = graph.isNodeDeleted(node_id);
+		const std::vector<int>& pred = graph.nodePredecessors(node_id);
+		for (size_t i = 0; i < pred.size(); ++i) {
+			addArc(pred[i], node_id);
+		}
+	}
+}
+
+size_t SimpleDirectedGraph::memoryBytes() const {
+	size_t bytes = m_nodes.capacity() * sizeof(Node);
+	for (size_t i = 0; i < m_nodes.size(); ++i) {
+		const Node& node = m_nodes[i];
+		bytes += (node.m_predecessors.capacity() + node.m_successors.capacity() +
+				node.m_sortedSuccessors.capacity()) * sizeof(int);
+	}
+	return bytes;
+}
+
 bool SimpleDirectedGraph::areConnected(int source, int target) const {
 	if (source == target) return true;
 	SimpleDirectedGraph::BFIterator source_it(*this, 0x3fffffff, true);
@@ -83,6 +394,9 @@ bool SimpleDirectedGraph::areConnected(int source, int target) const {
 
 bool SimpleDirectedGraph::hasArc(int source, int target) const {
 	const Node& node = m_nodes[source];
+	if (!node.m_sortedSuccessors.empty()) {
+		return std::binary_search(node.m_sortedSuccessors.begin(), node.m_sortedSuccessors.end(), target);
+	}
 	for (size_t i = 0; i < node.m_successors.size(); ++i) {
 		if (node.m_successors[i] == target) return true;
 	}
@@ -92,6 +406,7 @@ bool SimpleDirectedGraph::hasArc(int source, int target) const {
 void SimpleDirectedGraph::deleteNode(int nodeId, bool always_add_shortcut) {
 	Node& node = m_nodes[nodeId];
 	if (node.m_deleted) return;  // Already deleted node.
+	if (m_queryCache != NULL) m_queryCache->clear();
 	// Delete the links from other nodes to this node.
 	for (size_t i = 0; i < node.m_predecessors.size(); ++i) {
 		deleteArcFromSuccessors(node.m_predecessors[i], nodeId);
@@ -113,6 +428,100 @@ void SimpleDirectedGraph::deleteNode(int nodeId, bool always_add_shortcut) {
 	node.m_deleted = true;
 	node.m_predecessors.clear();
 	node.m_successors.clear();
+	node.m_sortedSuccessors.clear();
+}
+
+void SimpleDirectedGraph::deleteNodes(const std::vector<int>& node_ids) {
+	std::vector<bool> removed(m_nodes.size(), false);
+	for (size_t i = 0; i < node_ids.size(); ++i) {
+		if (!m_nodes[node_ids[i]].m_deleted) removed[node_ids[i]] = true;
+	}
+	if (m_queryCache != NULL) m_queryCache->clear();
+	// Find the remaining nodes reached from every remaining node through the deleted ones.
+	std::vector<std::pair<int, int> > shortcuts;
+	std::vector<int> visited_from(m_nodes.size(), -1);
+	std::vector<int> stack;
+	for (size_t source = 0; source < m_nodes.size(); ++source) {
+		if (removed[source]) continue;
+		const std::vector<int>& succ = m_nodes[source].m_successors;
+		for (size_t i = 0; i < succ.size(); ++i) {
+			if (removed[succ[i]] && visited_from[succ[i]] != static_cast<int>(source)) {
+				visited_from[succ[i]] = source;
+				stack.push_back(succ[i]);
+			}
+		}
+		while (!stack.empty()) {
+			int node_id = stack.back();
+			stack.pop_back();
+			const std::vector<int>& next = m_nodes[node_id].m_successors;
+			for (size_t i = 0; i < next.size(); ++i) {
+				if (visited_from[next[i]] == static_cast<int>(source)) continue;
+				visited_from[next[i]] = source;
+				if (removed[next[i]]) {
+					stack.push_back(next[i]);
+				} else if (next[i] != static_cast<int>(source)) {
+					shortcuts.push_back(std::pair<int, int>(source, next[i]));
+				}
+			}
+		}
+	}
+	removeArcsOfNodes(removed);
+	for (size_t i = 0; i < m_nodes.size(); ++i) {
+		if (!removed[i]) continue;
+		Node& node = m_nodes[i];
+		node.m_deleted = true;
+		node.m_predecessors.clear();
+		node.m_successors.clear();
+		node.m_sortedSuccessors.clear();
+	}
+	// The shortcuts are grouped by their source. Mark the nodes at most two arcs away from
+	// the source once per group.
+	std::vector<int> near_source(m_nodes.size(), -1);
+	for (size_t i = 0; i < shortcuts.size(); ++i) {
+		int source = shortcuts[i].first;
+		int target = shortcuts[i].second;
+		if (i == 0 || shortcuts[i - 1].first != source) {
+			const std::vector<int>& succ = m_nodes[source].m_successors;
+			for (size_t j = 0; j < succ.size(); ++j) {
+				markSuccessors(succ[j], source, &near_source);
+			}
+		}
+		if (near_source[target] == source) continue;
+		addArc(source, target);
+		markSuccessors(target, source, &near_source);
+	}
+}
+
+void SimpleDirectedGraph::markSuccessors(int node_id, int mark, std::vector<int>* marks) const {
+	(*marks)[node_id] = mark;
+	const std::vector<int>& succ = m_nodes[node_id].m_successors;
+	for (size_t i = 0; i < succ.size(); ++i) {
+		(*marks)[succ[i]] = mark;
+	}
+}
+
+void SimpleDirectedGraph::removeArcsOfNodes(const std::vector<bool>& removed) {
+	for (size_t i = 0; i < m_nodes.size(); ++i) {
+		if (removed[i]) continue;
+		Node& node = m_nodes[i];
+		size_t num_succ = 0;
+		for (size_t j = 0; j < node.m_successors.size(); ++j) {
+			if (!removed[node.m_successors[j]]) node.m_successors[num_succ++] = node.m_successors[j];
+		}
+		if (num_succ != node.m_successors.size()) {
+			node.m_successors.resize(num_succ);
+			node.m_sortedSuccessors.clear();
+			if (node.m_successors.size() >= kSortedSuccessorsDegree) {
+				node.m_sortedSuccessors = node.m_successors;
+				std::sort(node.m_sortedSuccessors.begin(), node.m_sortedSuccessors.end());
+			}
+		}
+		size_t num_pred = 0;
+		for (size_t j = 0; j < node.m_predecessors.size(); ++j) {
+			if (!removed[node.m_predecessors[j]]) node.m_predecessors[num_pred++] = node.m_predecessors[j];
+		}
+		node.m_predecessors.resize(num_pred);
+	}
 }
 
 void SimpleDirectedGraph::addShortcutArcIfNeeded(int source, int target) {
@@ -127,6 +536,12 @@ void SimpleDirectedGraph::addShortcutArcIfNeeded(int source, int target) {
 
 void SimpleDirectedGraph::deleteArcFromSuccessors(int source, int target) {
 	Node& node = m_nodes[source];
+	if (!node.m_sortedSuccessors.empty()) {
+		std::vector<int>::iterator it = std::lower_bound(
+				node.m_sortedSuccessors.begin(), node.m_sortedSuccessors.end(), target);
+		if (it == node.m_sortedSuccessors.end() || *it != target) return;
+		node.m_sortedSuccessors.erase(it);
+	}
 	for (size_t i = 0; i < node.m_successors.size(); ++i) {
 		if (node.m_successors[i] == target) {
 			node.m_successors.erase(node.m_successors.begin() + i);
@@ -22,19 +22,47 @@
 #include <set>
 #include <utility>
 
+class AnalysisProgress;
+class ReachabilityCache;
+class SimpleDirectedGraph;
+
 class EventGraphInterface {
 public:
+	// A (source, target) pair for areOrderedBatch.
+	typedef std::pair<int, int> OrderQuery;
+
 	virtual ~EventGraphInterface();
 	virtual bool areOrdered(int source, int target) const = 0;
+	// The backends hide this with a non-virtual version of areOrdered, so that the code
+	// templated on the backend type can inline the query.
+	bool isOrdered(int source, int target) const {
+		return areOrdered(source, target);
+	}
+
+	// Sets (*ordered)[i] to areOrdered(queries[i].first, queries[i].second). The backends
+	// answer the queries grouped by the node whose connectivity data they read.
+	virtual void areOrderedBatch(const std::vector<OrderQuery>& queries, std::vector<bool>* ordered) const;
+
+	// Updates the connectivity information after nodes were appended to the graph it
+	// was built from. All arcs added to the graph since the last update must end in the
+	// new nodes (the nodes with id >= first_new_node).
+	virtual void extend(const SimpleDirectedGraph& graph, int first_new_node) = 0;
+
+protected:
+	// Fills order with the indices of the queries sorted by their targets. The queries
+	// are not reordered if their targets are already increasing or decreasing.
+	static void sortQueriesByTarget(const std::vector<OrderQuery>& queries, std::vector<int>* order);
 };
 
 class SimpleDirectedGraph : public EventGraphInterface {
 public:
 	SimpleDirectedGraph();
+	// The query cache is not copied.
+	SimpleDirectedGraph(const SimpleDirectedGraph& other);
+	SimpleDirectedGraph& operator=(const SimpleDirectedGraph& other);
+	virtual ~SimpleDirectedGraph();
 
-	void createEmptyGraph(int node_count) {
-		m_nodes.assign(node_count, Node());
-	}
+	void createEmptyGraph(int node_count);
 	void addNodesUpTo(int node_id) {
 		m_nodes.resize(node_id + 1, Node());
 	}
@@ -49,11 +77,47 @@ public:
 		return m_nodes[node_id].m_deleted;
 	}
 	void addArc(int source, int target);
+	// Adds the arcs in the given order like addArc, skipping the loops, the duplicates and
+	// the arcs already in the graph. The duplicates are found by sorting the arcs, so this
+	// is faster than addArc for many arcs from the same node.
+	void addArcs(const std::vector<std::pair<int, int> >& arcs);
 	bool addArcIfNeeded(int source, int target);
 	void deleteArc(int source, int target);
 	void deleteNode(int nodeId, bool always_add_shortcut = false);
+	// Deletes the nodes in one pass over the graph. Instead of the shortcut arcs of every
+	// deleteNode call, adds an arc from every remaining predecessor of the deleted nodes to
+	// each remaining node it reached through them, unless it is at most two arcs away.
+	void deleteNodes(const std::vector<int>& node_ids);
+	// Deletes the arcs to later nodes that are implied by other paths over arcs to later
+	// nodes, keeping the order of the other arcs. This keeps the answers of areOrdered and of
+	// the clocks built from the graph. Returns the number of deleted arcs.
+	int removeTransitiveArcs(AnalysisProgress* progress);
+
+	virtual bool areOrdered(int source, int target) const {
+		return isOrdered(source, target);
+	}
+	// Same as areOrdered, for the loops that are templated on the backend.
+	bool isOrdered(int source, int target) const;
+	// Runs one search for all the queries with the same source.
+	virtual void areOrderedBatch(const std::vector<OrderQuery>& queries, std::vector<bool>* ordered) const;
+	// Sets (*ordered)[i * targets.size() + j] to areOrdered(sources[i], targets[j]). If
+	// avoid_sources is set, the paths may not pass through the other sources. Up to 64
+	// sources are searched together in one sweep over the graph, which takes memory
+	// proportional to the number of nodes.
+	void areOrderedMulti(const std::vector<int>& sources, const std::vector<int>& targets,
+			bool avoid_sources, std::vector<bool>* ordered) const;
+	// Copies the nodes with id >= first_new_node and their incoming arcs from graph.
+	virtual void extend(const SimpleDirectedGraph& graph, int first_new_node);
+
+	// Keeps the searches of areOrdered for up to max_sources recent sources. The kept
+	// searches are updated when arcs are added. 0 disables the cache.
+	void setQueryCacheSize(int max_sources);
+	// NULL if the cache is disabled.
+	const ReachabilityCache* queryCache() const { return m_queryCache; }
+
+	// The memory allocated for the nodes and the arcs, without the query cache.
+	size_t memoryBytes() const;
 
-	virtual bool areOrdered(int source, int target) const;
 	bool areConnected(int source, int target) const;
 	bool hasArc(int source, int target) const;
 
@@ -140,6 +204,15 @@ private:
 	void deleteArcFromSuccessors(int source, int target);
 	void deleteArcFromPredecessors(int source, int target);
 	void addShortcutArcIfNeeded(int source, int target);
+	// Removes the arcs from and to the nodes marked in removed, keeping the order of the
+	// other arcs.
+	void removeArcsOfNodes(const std::vector<bool>& removed);
+	// Sets the marks of node_id and of its successors to mark.
+	void markSuccessors(int node_id, int mark, std::vector<int>* marks) const;
+	// Sets (*target_masks)[j] to the mask of the sources (at most 64) ordered before the
+	// target sorted_targets[j].
+	void findSourceMasks(const std::vector<int>& sources, const std::vector<int>& sorted_targets,
+			bool avoid_sources, std::vector<unsigned long long>* target_masks) const;
 
 	struct Node {
 		Node() : m_deleted(false) {
@@ -148,9 +221,17 @@ private:
 		bool m_deleted;
 		std::vector<int> m_predecessors;
 		std::vector<int> m_successors;
+		// The successors in increasing order, kept for the nodes with at least
+		// kSortedSuccessorsDegree successors, so that hasArc does not scan them all.
+		std::vector<int> m_sortedSuccessors;
 	};
+	static const size_t kSortedSuccessorsDegree = 64;
+
+	// Updates the sorted successors after target was appended to the successors of node.
+	static void addSortedSuccessor(Node* node, int target);
 
 	std::vector<Node> m_nodes;
+	ReachabilityCache* m_queryCache;
 };
 
 #endif /* EVENTGRAPH_H_ */
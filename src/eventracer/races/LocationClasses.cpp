@@ -0,0 +1,79 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+
+#include "LocationClasses.h"
+
+#include <string.h>
+
+#include "StringSet.h"
+
+LocationClasses::LocationClasses() {
+}
+
+LocationClasses::LocationClasses(const StringSet& vars) {
+	update(vars);
+}
+
+void LocationClasses::update(const StringSet& vars) {
+	int location = m_classes.size();
+	m_classes.resize(vars.endIndex(), 0);
+	m_extractedIds.resize(vars.endIndex(), -1);
+	while (location < vars.endIndex()) {
+		if (vars.isDerivedString(location)) {
+			// The name starts with the name of the base.
+			m_classes[location] = m_classes[vars.derivedStringBase(location)];
+			m_extractedIds[location] = m_extractedIds[vars.derivedStringBase(location)];
+		} else {
+			m_classes[location] = classify(vars.getString(location), location);
+		}
+		location = vars.nextIndex(location);
+	}
+}
+
+int LocationClasses::classify(const char* name, int location) {
+	int classes = 0;
+	switch (name[0]) {
+	case 'O': classes |= OBJECT; break;
+	case 'A': classes |= ARRAY; break;
+	case 'W': classes |= WINDOW; break;
+	case 'J': classes |= JS_ACTIVATION; break;
+	}
+
+	const char* id = NULL;
+	if (strncmp(name, "CachedResource-", 15) == 0) {
+		classes |= SCRIPT_RUNNER;
+		id = name + 15;
+	} else if (strncmp(name, "ScriptRunner-", 13) == 0) {
+		classes |= SCRIPT_RUNNER;
+		id = name + 13;
+	} else if (strncmp(name, "NodeTree:", 9) == 0) {
+		classes |= NODE_TREE;
+		id = name + 9;
+	}
+	if (id != NULL) {
+		std::map<std::string, int>::iterator it = m_idsByText.insert(
+				std::make_pair(std::string(id), static_cast<int>(m_idsByText.size()))).first;
+		m_extractedIds[location] = it->second;
+	}
+
+	if (strncmp(name, "Window", 6) == 0 ||
+			strncmp(name, "Tree", 4) == 0 ||
+			strncmp(name, "NodeTree", 8) == 0) {
+		classes |= USER_VISIBLE;
+	}
+	return classes;
+}
@@ -0,0 +1,73 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+
+#ifndef LOCATIONCLASSES_H_
+#define LOCATIONCLASSES_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+class StringSet;
+
+// Properties of the memory locations in a StringSet that the filters test on every access
+// to a location. They are computed once per location from its name, and the filters look
+// them up by the index of the name instead of comparing the name.
+class LocationClasses {
+public:
+	enum Class {
+		// The first character of the name.
+		OBJECT = 1 << 0,         // 'O'
+		ARRAY = 1 << 1,          // 'A'
+		WINDOW = 1 << 2,         // 'W'
+		JS_ACTIVATION = 1 << 3,  // 'J'
+		// CachedResource-<id> or ScriptRunner-<id>.
+		SCRIPT_RUNNER = 1 << 4,
+		// NodeTree:<id>.
+		NODE_TREE = 1 << 5,
+		// A Window, Tree or NodeTree name, i.e. state of the page that the user can see.
+		USER_VISIBLE = 1 << 6
+	};
+
+	LocationClasses();
+	explicit LocationClasses(const StringSet& vars);
+
+	// Classifies the locations added to vars since the last update.
+	void update(const StringSet& vars);
+
+	bool is(int location, int location_class) const {
+		return (m_classes[location] & location_class) != 0;
+	}
+
+	// The <id> of a SCRIPT_RUNNER or NODE_TREE location as a number below numExtractedIds().
+	// The locations with the same <id> text get the same number, and the derived names (see
+	// StringSet::addDerivedString) get the number of their base. -1 for the other locations.
+	int extractedId(int location) const {
+		return m_extractedIds[location];
+	}
+	int numExtractedIds() const { return m_idsByText.size(); }
+
+private:
+	int classify(const char* name, int location);
+
+	// Indexed by location. Only the indices where a name starts are used.
+	std::vector<unsigned char> m_classes;
+	std::vector<int> m_extractedIds;
+	std::map<std::string, int> m_idsByText;
+};
+
+#endif /* LOCATIONCLASSES_H_ */
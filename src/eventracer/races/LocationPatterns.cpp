@@ -0,0 +1,114 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+
+#include "LocationPatterns.h"
+
+#include <algorithm>
+
+#include "StringSet.h"
+
+LocationPatterns::LocationPatterns(const std::vector<std::string>& patterns) {
+	// Build the trie of the patterns.
+	m_transitions.assign(256, -1);
+	m_output.resize(1);
+	for (size_t i = 0; i < patterns.size(); ++i) {
+		int state = 0;
+		for (size_t j = 0; j < patterns[i].size(); ++j) {
+			int c = static_cast<unsigned char>(patterns[i][j]);
+			if (m_transitions[state * 256 + c] == -1) {
+				m_transitions[state * 256 + c] = m_output.size();
+				m_transitions.resize(m_transitions.size() + 256, -1);
+				m_output.push_back(std::vector<int>());
+			}
+			state = m_transitions[state * 256 + c];
+		}
+		m_output[state].push_back(i);
+	}
+
+	// Compute the suffix links in breadth first order and turn the trie into an automaton.
+	int num_states = m_output.size();
+	std::vector<int> suffix_link(num_states, 0);
+	m_outputLink.assign(num_states, -1);
+	std::vector<int> queue;
+	for (int c = 0; c < 256; ++c) {
+		int next = m_transitions[c];
+		if (next == -1) {
+			m_transitions[c] = 0;
+		} else {
+			if (!m_output[0].empty()) m_outputLink[next] = 0;
+			queue.push_back(next);
+		}
+	}
+	for (size_t i = 0; i < queue.size(); ++i) {
+		int state = queue[i];
+		for (int c = 0; c < 256; ++c) {
+			int next = m_transitions[state * 256 + c];
+			int fallback = m_transitions[suffix_link[state] * 256 + c];
+			if (next == -1) {
+				m_transitions[state * 256 + c] = fallback;
+			} else {
+				suffix_link[next] = fallback;
+				m_outputLink[next] = m_output[fallback].empty() ? m_outputLink[fallback] : fallback;
+				queue.push_back(next);
+			}
+		}
+	}
+}
+
+void LocationPatterns::match(const StringSet& vars) {
+	m_matchesAny.assign(vars.endIndex(), false);
+	m_matchedPatterns.clear();
+	std::vector<int> matched;
+	int location = 0;
+	while (location < vars.endIndex()) {
+		const char* name = vars.getString(location);
+		matched.clear();
+		addOutput(0, &matched);
+		int state = 0;
+		const char* p = name;
+		for (; *p != 0; ++p) {
+			state = m_transitions[state * 256 + static_cast<unsigned char>(*p)];
+			addOutput(state, &matched);
+		}
+		if (!matched.empty()) {
+			std::sort(matched.begin(), matched.end());
+			matched.erase(std::unique(matched.begin(), matched.end()), matched.end());
+			m_matchesAny[location] = true;
+			m_matchedPatterns[location] = matched;
+		}
+		location = vars.nextIndex(location);
+	}
+}
+
+void LocationPatterns::addOutput(int state, std::vector<int>* matched) const {
+	if (m_output[state].empty()) state = m_outputLink[state];
+	while (state != -1) {
+		matched->insert(matched->end(), m_output[state].begin(), m_output[state].end());
+		state = m_outputLink[state];
+	}
+}
+
+const std::vector<int>& LocationPatterns::matchedPatterns(int location) const {
+	if (!m_matchesAny[location]) return m_noPatterns;
+	return m_matchedPatterns.find(location)->second;
+}
+
+bool LocationPatterns::matches(int location, int pattern) const {
+	if (!m_matchesAny[location]) return false;
+	const std::vector<int>& matched = m_matchedPatterns.find(location)->second;
+	return std::binary_search(matched.begin(), matched.end(), pattern);
+}
@@ -0,0 +1,61 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+
+#ifndef LOCATIONPATTERNS_H_
+#define LOCATIONPATTERNS_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+class StringSet;
+
+// Finds which of a list of patterns occur in the names of the locations in a StringSet.
+// All the names are matched against all the patterns in one pass over the names with an
+// Aho-Corasick automaton.
+class LocationPatterns {
+public:
+	explicit LocationPatterns(const std::vector<std::string>& patterns);
+
+	// Matches the names of the locations in vars.
+	void match(const StringSet& vars);
+
+	bool matchesAny(int location) const {
+		return m_matchesAny[location];
+	}
+	// The indices of the patterns that occur in the name of the location, in increasing order.
+	const std::vector<int>& matchedPatterns(int location) const;
+	bool matches(int location, int pattern) const;
+
+private:
+	// Adds the patterns that end at the given state of the automaton to matched.
+	void addOutput(int state, std::vector<int>* matched) const;
+
+	// The automaton, with 256 transitions per state. State 0 is the root.
+	std::vector<int> m_transitions;
+	// The patterns that end at each state, and the next state on the suffix link path with
+	// patterns that end at it (or -1).
+	std::vector<std::vector<int> > m_output;
+	std::vector<int> m_outputLink;
+
+	// Indexed by location.
+	std::vector<bool> m_matchesAny;
+	std::map<int, std::vector<int> > m_matchedPatterns;
+	std::vector<int> m_noPatterns;
+};
+
+#endif /* LOCATIONPATTERNS_H_ */
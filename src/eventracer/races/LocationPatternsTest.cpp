@@ -0,0 +1,133 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "LocationPatterns.h"
+#include "StringSet.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "stringprintf.h"
+
+std::string patternsToString(const std::vector<int>& patterns) {
+	std::string out;
+	for (size_t i = 0; i < patterns.size(); ++i) {
+		StringAppendF(&out, "[%d]", patterns[i]);
+	}
+	return out;
+}
+
+// Checks that the patterns matched for every name in vars are the ones strstr finds.
+void expectMatchesStrstr(const std::vector<std::string>& patterns, const StringSet& vars) {
+	LocationPatterns matcher(patterns);
+	matcher.match(vars);
+	for (int location = 0; location < vars.endIndex(); location = vars.nextIndex(location)) {
+		const char* name = vars.getString(location);
+		std::vector<int> expected;
+		for (size_t i = 0; i < patterns.size(); ++i) {
+			if (strstr(name, patterns[i].c_str()) != NULL) {
+				expected.push_back(i);
+			}
+		}
+		bool correct = matcher.matchedPatterns(location) == expected &&
+				matcher.matchesAny(location) == !expected.empty();
+		for (size_t i = 0; i < patterns.size(); ++i) {
+			bool expected_match = strstr(name, patterns[i].c_str()) != NULL;
+			if (matcher.matches(location, i) != expected_match) correct = false;
+		}
+		if (!correct) {
+			fprintf(stderr, "Test failed on location %s! Expected patterns: %s, actual %s\n^^^ FAIL ^^^\n",
+					name, patternsToString(expected).c_str(),
+					patternsToString(matcher.matchedPatterns(location)).c_str());
+			throw 0;
+		}
+	}
+}
+
+void addNames(const char* const* names, int num_names, StringSet* vars) {
+	for (int i = 0; i < num_names; ++i) {
+		vars->addString(names[i]);
+	}
+}
+
+void testOverlappingPatterns() {
+	printf("Starting test testOverlappingPatterns...\n");
+	// "he" is a suffix of "she", and "hers" and "his" overlap with both.
+	const char* patterns[] = { "he", "she", "his", "hers", "aa", "b", "ab", "he" };
+	const char* names[] = { "", "ushers", "ahishers", "she", "h", "aaa", "ab", "xyz", "hehe", "abab" };
+	StringSet vars;
+	addNames(names, 10, &vars);
+	expectMatchesStrstr(std::vector<std::string>(patterns, patterns + 8), vars);
+	printf("Success\n");
+}
+
+void testEmptyPattern() {
+	printf("Starting test testEmptyPattern...\n");
+	// The empty pattern occurs in every name, including the empty one.
+	const char* patterns[] = { "x", "", "xy" };
+	const char* names[] = { "", "x", "axy", "b" };
+	StringSet vars;
+	addNames(names, 4, &vars);
+	expectMatchesStrstr(std::vector<std::string>(patterns, patterns + 3), vars);
+	printf("Success\n");
+}
+
+void testHighBytes() {
+	printf("Starting test testHighBytes...\n");
+	const char* patterns[] = { "\xc3\xa9", "\xff", "a\x80", "\xa9z" };
+	const char* names[] = { "caf\xc3\xa9", "\xc3", "\xa9z\xff", "a\x80\x80", "ascii" };
+	StringSet vars;
+	addNames(names, 5, &vars);
+	expectMatchesStrstr(std::vector<std::string>(patterns, patterns + 4), vars);
+	printf("Success\n");
+}
+
+void testRandomNames() {
+	printf("Starting test testRandomNames...\n");
+	const char alphabet[] = "abh\xc3\xff";
+	srand(1);
+	for (int test = 0; test < 200; ++test) {
+		std::vector<std::string> patterns;
+		int num_patterns = rand() % 6;
+		for (int i = 0; i < num_patterns; ++i) {
+			std::string pattern;
+			int length = rand() % 4;
+			for (int j = 0; j < length; ++j) pattern += alphabet[rand() % 5];
+			patterns.push_back(pattern);
+		}
+		StringSet vars;
+		for (int i = 0; i < 20; ++i) {
+			std::string name;
+			int length = rand() % 10;
+			for (int j = 0; j < length; ++j) name += alphabet[rand() % 5];
+			vars.addString(name.c_str());
+		}
+		expectMatchesStrstr(patterns, vars);
+	}
+	printf("Success\n");
+}
+
+int main(void) {
+	testOverlappingPatterns();
+	testEmptyPattern();
+	testHighBytes();
+	testRandomNames();
+	return 0;
+}
@@ -0,0 +1,75 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+
+#include "MemoryValues.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <sstream>
+#include <string>
+
+#include "StringSet.h"
+#include "strutil.h"
+
+MemoryValues::MemoryValues() {
+}
+
+MemoryValues::MemoryValues(const StringSet& values) {
+	update(values);
+}
+
+void MemoryValues::update(const StringSet& values) {
+	int value = m_offsets.empty() ? 0 : values.nextIndex(m_offsets.back());
+	while (value < values.endIndex()) {
+		m_offsets.push_back(value);
+		m_values.push_back(parse(values.getString(value)));
+		value = values.nextIndex(value);
+	}
+}
+
+MemoryValues::Value MemoryValues::parse(const char* s) {
+	Value result;
+	result.m_kind = STRING;
+	result.m_number = 0;
+	if (ParseInt32(s, &result.m_number)) {
+		result.m_kind = INT;
+	} else if (strcmp(s, "true") == 0) {
+		result.m_kind = BOOLEAN;
+		result.m_number = 1;
+	} else if (strcmp(s, "false") == 0) {
+		result.m_kind = BOOLEAN;
+	} else if (strcmp(s, "undefined") == 0) {
+		result.m_kind = UNDEFINED;
+	} else if (strcmp(s, "null") == 0) {
+		result.m_kind = NULL_VALUE;
+	} else if (sscanf(s, "Function[%d]", &result.m_number) == 1) {
+		result.m_kind = FUNCTION;
+	} else {
+		result.m_number = 0;
+	}
+
+	result.m_falsy = strcmp(s, "undefined") == 0 ||
+			strcmp(s, "false") == 0 ||
+			strcmp(s, "null") == 0 ||
+			strcmp(s, "\"\"") == 0 ||
+			strcmp(s, "0") == 0;
+
+	result.m_leadingInt = 0;
+	std::istringstream(s) >> result.m_leadingInt;
+	return result;
+}
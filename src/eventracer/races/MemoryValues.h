@@ -0,0 +1,85 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+
+#ifndef MEMORYVALUES_H_
+#define MEMORYVALUES_H_
+
+#include <algorithm>
+#include <vector>
+
+class StringSet;
+
+// The memory values of a trace, parsed once per distinct value. A value is identified by
+// the index of its string in the memory values StringSet, as in the MEMORY_VALUE commands.
+class MemoryValues {
+public:
+	enum Kind {
+		STRING = 0,
+		// A whole string that ParseInt32 accepts.
+		INT,
+		// true or false.
+		BOOLEAN,
+		UNDEFINED,
+		NULL_VALUE,
+		// Function[<id>].
+		FUNCTION
+	};
+
+	MemoryValues();
+	explicit MemoryValues(const StringSet& values);
+
+	// Parses the values added to values since the last update.
+	void update(const StringSet& values);
+
+	Kind kind(int value) const {
+		return static_cast<Kind>(find(value).m_kind);
+	}
+	// The integer of an INT value, 1 for true and 0 for false, and the id of a FUNCTION.
+	// 0 for the other values.
+	int number(int value) const {
+		return find(value).m_number;
+	}
+	// The integer that an std::istream reads from the start of the value, 0 if it reads
+	// none.
+	int leadingInt(int value) const {
+		return find(value).m_leadingInt;
+	}
+	// undefined, false, null, "" or 0, the values that x = x || y overwrites.
+	bool isFalsy(int value) const {
+		return find(value).m_falsy;
+	}
+
+private:
+	struct Value {
+		unsigned char m_kind;
+		bool m_falsy;
+		int m_number;
+		int m_leadingInt;
+	};
+
+	static Value parse(const char* s);
+
+	const Value& find(int value) const {
+		return m_values[std::lower_bound(m_offsets.begin(), m_offsets.end(), value) - m_offsets.begin()];
+	}
+
+	// The index in the StringSet of each value in m_values, in increasing order.
+	std::vector<int> m_offsets;
+	std::vector<Value> m_values;
+};
+
+#endif /* MEMORYVALUES_H_ */
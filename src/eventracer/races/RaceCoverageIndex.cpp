@@ -0,0 +1,97 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "RaceCoverageIndex.h"
+
+#include "EventGraph.h"
+
+#include <algorithm>
+#include <utility>
+
+RaceCoverageIndex::RaceCoverageIndex(const VarsInfo::AllRaces& races) {
+	std::vector<std::pair<int, int> > by_event1;
+	m_raceEvent1.reserve(races.size());
+	m_raceEvent2.reserve(races.size());
+	for (size_t i = 0; i < races.size(); ++i) {
+		by_event1.push_back(std::make_pair(races[i].m_event1, static_cast<int>(i)));
+		m_raceEvent1.push_back(races[i].m_event1);
+		m_raceEvent2.push_back(races[i].m_event2);
+	}
+	std::sort(by_event1.begin(), by_event1.end());
+	for (size_t i = 0; i < by_event1.size(); ++i) {
+		m_event1.push_back(by_event1[i].first);
+		m_raceByEvent1.push_back(by_event1[i].second);
+	}
+	if (!races.empty()) {
+		m_maxEvent2.assign(4 * races.size(), 0);
+		buildMaxTree(1, 0, races.size());
+	}
+}
+
+void RaceCoverageIndex::buildMaxTree(int tree_node, int from, int to) {
+	if (to - from == 1) {
+		m_maxEvent2[tree_node] = m_raceEvent2[m_raceByEvent1[from]];
+		return;
+	}
+	int mid = (from + to) / 2;
+	buildMaxTree(2 * tree_node, from, mid);
+	buildMaxTree(2 * tree_node + 1, mid, to);
+	m_maxEvent2[tree_node] = std::max(m_maxEvent2[2 * tree_node], m_maxEvent2[2 * tree_node + 1]);
+}
+
+void RaceCoverageIndex::reportRaces(int tree_node, int from, int to, int limit, int min_event2,
+		std::vector<int>* result) const {
+	if (from >= limit || m_maxEvent2[tree_node] < min_event2) return;
+	if (to - from == 1) {
+		result->push_back(m_raceByEvent1[from]);
+		return;
+	}
+	int mid = (from + to) / 2;
+	reportRaces(2 * tree_node, from, mid, limit, min_event2, result);
+	reportRaces(2 * tree_node + 1, mid, to, limit, min_event2, result);
+}
+
+void RaceCoverageIndex::findCoveredRaces(int race_id, const EventGraphInterface& graph,
+		std::vector<int>* covered_races, int first_candidate) const {
+	covered_races->clear();
+	int event1 = m_raceEvent1[race_id];
+	int event2 = m_raceEvent2[race_id];
+	int limit = std::upper_bound(m_event1.begin(), m_event1.end(), event1) - m_event1.begin();
+	std::vector<int> candidates;
+	reportRaces(1, 0, m_raceEvent1.size(), limit, event2, &candidates);
+	std::sort(candidates.begin(), candidates.end());
+
+	// race_id being a synchronization could prevent race2 if race2 is ordered around it.
+	std::vector<int> races;
+	std::vector<EventGraphInterface::OrderQuery> after_queries;
+	std::vector<EventGraphInterface::OrderQuery> before_queries;
+	for (size_t i = 0; i < candidates.size(); ++i) {
+		int race2 = candidates[i];
+		if (race2 <= race_id || race2 < first_candidate) continue;
+		races.push_back(race2);
+		after_queries.push_back(EventGraphInterface::OrderQuery(event2, m_raceEvent2[race2]));
+		before_queries.push_back(EventGraphInterface::OrderQuery(m_raceEvent1[race2], event1));
+	}
+	std::vector<bool> after;
+	std::vector<bool> before;
+	graph.areOrderedBatch(after_queries, &after);
+	graph.areOrderedBatch(before_queries, &before);
+	for (size_t i = 0; i < races.size(); ++i) {
+		if (after[i] && before[i]) {
+			covered_races->push_back(races[i]);
+		}
+	}
+}
@@ -0,0 +1,62 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef RACECOVERAGEINDEX_H_
+#define RACECOVERAGEINDEX_H_
+
+#include <vector>
+#include "VarsInfo.h"
+
+class EventGraphInterface;
+
+// Range tree over races that finds the races covered by a given race without
+// checking all pairs of races.
+//
+// Race j covers race i if e2(j) is ordered before e2(i) and e1(i) is ordered before e1(j).
+// All connectivity algorithms only order a node before nodes with a higher or equal id,
+// so race i can only be covered by race j if e1(i) <= e1(j) and e2(i) >= e2(j).
+// The index answers this dominance query on the event ids and only the races
+// spanning race j get checked with the (more expensive) connectivity algorithm.
+class RaceCoverageIndex {
+public:
+	// The index must be rebuilt when the races change.
+	explicit RaceCoverageIndex(const VarsInfo::AllRaces& races);
+
+	// Sets covered_races to the sorted list of races i > race_id, i >= first_candidate that race_id covers.
+	// Gives exactly the same result as checking all these races.
+	void findCoveredRaces(int race_id, const EventGraphInterface& graph,
+			std::vector<int>* covered_races, int first_candidate) const;
+
+private:
+	void buildMaxTree(int tree_node, int from, int to);
+
+	// Appends to result all races in [from, to) intersected with [0, limit)
+	// with second event at least min_event2.
+	void reportRaces(int tree_node, int from, int to, int limit, int min_event2,
+			std::vector<int>* result) const;
+
+	// The events of every race, indexed by the race id.
+	std::vector<int> m_raceEvent1;
+	std::vector<int> m_raceEvent2;
+
+	// Race ids sorted by their first event.
+	std::vector<int> m_raceByEvent1;
+	std::vector<int> m_event1;
+	// Segment tree with the maximum second event for a range of m_raceByEvent1.
+	std::vector<int> m_maxEvent2;
+};
+
+#endif /* RACECOVERAGEINDEX_H_ */
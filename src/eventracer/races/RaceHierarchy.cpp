@@ -0,0 +1,98 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "RaceHierarchy.h"
+
+#include <stdio.h>
+
+#include "base.h"
+#include "VarsInfo.h"
+
+RaceHierarchy::RaceHierarchy() : m_vinfo(NULL), m_threadStarted(false), m_ready(false),
+	m_stopRequested(false) {
+}
+
+RaceHierarchy::~RaceHierarchy() {
+	if (m_threadStarted) {
+		{
+			lock_guard<mutex> lock(m_mutex);
+			m_stopRequested = true;
+		}
+		pthread_join(m_thread, NULL);
+	}
+}
+
+void RaceHierarchy::startBuild(const VarsInfo* vinfo) {
+	if (m_threadStarted) return;
+	m_vinfo = vinfo;
+	if (pthread_create(&m_thread, NULL, &RaceHierarchy::buildThread, this) != 0) {
+		fprintf(stderr, "Could not start a thread for the race hierarchy.\n");
+		return;
+	}
+	m_threadStarted = true;
+}
+
+void* RaceHierarchy::buildThread(void* self) {
+	static_cast<RaceHierarchy*>(self)->build();
+	return NULL;
+}
+
+void RaceHierarchy::build() {
+	int64 start_time = GetCurrentTimeMicros();
+	int num_races = m_vinfo->races().size();
+	std::vector<int> child_start[2];
+	std::vector<int> children[2];
+	std::vector<int> direct_children;
+	for (int mode = 0; mode < 2; ++mode) {
+		child_start[mode].reserve(num_races + 1);
+		for (int race_id = 0; race_id < num_races; ++race_id) {
+			if (stopRequested()) return;
+			child_start[mode].push_back(children[mode].size());
+			m_vinfo->computeDirectRaceChildren(race_id, mode != 0, &direct_children);
+			children[mode].insert(children[mode].end(), direct_children.begin(), direct_children.end());
+		}
+		child_start[mode].push_back(children[mode].size());
+	}
+
+	lock_guard<mutex> lock(m_mutex);
+	for (int mode = 0; mode < 2; ++mode) {
+		m_childStart[mode].swap(child_start[mode]);
+		m_children[mode].swap(children[mode]);
+	}
+	m_ready = true;
+	printf("Race hierarchy with %d and %d direct child races done (%lld ms).\n",
+			static_cast<int>(m_children[0].size()), static_cast<int>(m_children[1].size()),
+			(GetCurrentTimeMicros() - start_time) / 1000);
+}
+
+bool RaceHierarchy::stopRequested() const {
+	lock_guard<mutex> lock(m_mutex);
+	return m_stopRequested;
+}
+
+bool RaceHierarchy::getDirectRaceChildren(int race_id, bool only_different_event_actions,
+		std::set<int>* direct_child_races) const {
+	int mode = only_different_event_actions ? 1 : 0;
+	{
+		lock_guard<mutex> lock(m_mutex);
+		if (!m_ready) return false;
+	}
+	// Once computed, the hierarchy does not change.
+	direct_child_races->insert(
+			m_children[mode].begin() + m_childStart[mode][race_id],
+			m_children[mode].begin() + m_childStart[mode][race_id + 1]);
+	return true;
+}
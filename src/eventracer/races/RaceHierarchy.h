@@ -0,0 +1,68 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef RACEHIERARCHY_H_
+#define RACEHIERARCHY_H_
+
+#include <pthread.h>
+#include <set>
+#include <vector>
+
+#include "mutex.h"
+
+class VarsInfo;
+
+// The direct child races of every race (the reduction of the race coverage relation),
+// for both modes of VarsInfo::getDirectRaceChildren.
+//
+// The hierarchy is computed once in a background thread. Until it is done, the
+// callers are expected to compute the children on demand.
+class RaceHierarchy {
+public:
+	RaceHierarchy();
+	// Stops the background computation and waits for it.
+	~RaceHierarchy();
+
+	// Starts computing the hierarchy for the races in vinfo in a background thread.
+	// The races in vinfo must not change after this call.
+	void startBuild(const VarsInfo* vinfo);
+
+	// If the hierarchy is already computed, appends the direct child races of a race
+	// to the given set and returns true. Otherwise, returns false.
+	bool getDirectRaceChildren(int race_id, bool only_different_event_actions,
+			std::set<int>* direct_child_races) const;
+
+private:
+	static void* buildThread(void* self);
+	void build();
+	bool stopRequested() const;
+
+	const VarsInfo* m_vinfo;
+	pthread_t m_thread;
+	bool m_threadStarted;
+
+	mutable mutex m_mutex;
+	bool m_ready;
+	// Set by the destructor, build returns without a hierarchy.
+	bool m_stopRequested;
+
+	// The children of race i are m_children[mode][m_childStart[mode][i] .. m_childStart[mode][i + 1]),
+	// where mode is 1 if only_different_event_actions is set and 0 otherwise.
+	std::vector<int> m_childStart[2];
+	std::vector<int> m_children[2];
+};
+
+#endif /* RACEHIERARCHY_H_ */
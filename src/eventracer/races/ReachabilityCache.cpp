@@ -0,0 +1,125 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "ReachabilityCache.h"
+
+#include <algorithm>
+#include <functional>
+
+#include "EventGraph.h"
+
+ReachableSet::ReachableSet(int source)
+    : m_source(source), m_bound(0), m_maxExpanded(-1) {
+	setBit(&m_visited, source);
+	setBit(&m_ordered, source);
+	m_pending.push_back(source);
+}
+
+void ReachableSet::setBit(std::vector<unsigned int>* bits, int node) {
+	if (node / 32 >= static_cast<int>(bits->size())) {
+		bits->resize(node / 32 + 1, 0);
+	}
+	(*bits)[node / 32] |= 1u << (node % 32);
+}
+
+bool ReachableSet::isOrdered(const SimpleDirectedGraph& graph, int target) {
+	while (!m_pending.empty() && m_pending.front() < target) {
+		int node = m_pending.front();
+		std::pop_heap(m_pending.begin(), m_pending.end(), std::greater<int>());
+		m_pending.pop_back();
+		m_maxExpanded = std::max(m_maxExpanded, node);
+		const std::vector<int>& next = graph.nodeSuccessors(node);
+		for (size_t i = 0; i < next.size(); ++i) {
+			if (testBit(m_visited, next[i])) continue;
+			setBit(&m_visited, next[i]);
+			if (m_maxExpanded < next[i]) {
+				setBit(&m_ordered, next[i]);
+			}
+			m_pending.push_back(next[i]);
+			std::push_heap(m_pending.begin(), m_pending.end(), std::greater<int>());
+		}
+	}
+	m_bound = std::max(m_bound, target);
+	return testBit(m_ordered, target);
+}
+
+bool ReachableSet::addArc(int source, int target) {
+	if (!isExpanded(source) || testBit(m_ordered, target)) return true;
+	// The search already passed the target, so the nodes after it would need to be
+	// expanded again.
+	if (source > target || !testBit(m_ordered, source) ||
+			target < m_bound || testBit(m_visited, target)) return false;
+	setBit(&m_visited, target);
+	setBit(&m_ordered, target);
+	m_pending.push_back(target);
+	std::push_heap(m_pending.begin(), m_pending.end(), std::greater<int>());
+	return true;
+}
+
+ReachabilityCache::ReachabilityCache(int max_sources)
+    : m_maxSources(std::max(max_sources, 1)), m_numHits(0), m_numMisses(0),
+      m_numUpdated(0), m_numDropped(0) {
+}
+
+ReachabilityCache::~ReachabilityCache() {
+	clear();
+}
+
+bool ReachabilityCache::isOrdered(const SimpleDirectedGraph& graph, int source, int target) {
+	lock_guard<mutex> lock(m_mutex);
+	std::map<int, SetList::iterator>::iterator it = m_setBySource.find(source);
+	if (it != m_setBySource.end()) {
+		++m_numHits;
+		m_sets.splice(m_sets.begin(), m_sets, it->second);
+	} else {
+		++m_numMisses;
+		if (static_cast<int>(m_sets.size()) >= m_maxSources) {
+			ReachableSet* oldest = m_sets.back();
+			m_setBySource.erase(oldest->source());
+			m_sets.pop_back();
+			delete oldest;
+		}
+		m_sets.push_front(new ReachableSet(source));
+		m_setBySource[source] = m_sets.begin();
+	}
+	return m_sets.front()->isOrdered(graph, target);
+}
+
+void ReachabilityCache::addArc(int source, int target) {
+	lock_guard<mutex> lock(m_mutex);
+	for (SetList::iterator it = m_sets.begin(); it != m_sets.end();) {
+		if (!(*it)->isExpanded(source)) {
+			++it;
+		} else if ((*it)->addArc(source, target)) {
+			++m_numUpdated;
+			++it;
+		} else {
+			++m_numDropped;
+			m_setBySource.erase((*it)->source());
+			delete *it;
+			it = m_sets.erase(it);
+		}
+	}
+}
+
+void ReachabilityCache::clear() {
+	lock_guard<mutex> lock(m_mutex);
+	for (SetList::iterator it = m_sets.begin(); it != m_sets.end(); ++it) {
+		delete *it;
+	}
+	m_sets.clear();
+	m_setBySource.clear();
+}
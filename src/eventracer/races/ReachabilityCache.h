@@ -0,0 +1,110 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef REACHABILITYCACHE_H_
+#define REACHABILITYCACHE_H_
+
+#include <list>
+#include <map>
+#include <vector>
+
+#include "base.h"
+#include "mutex.h"
+
+class SimpleDirectedGraph;
+
+// The answers of SimpleDirectedGraph::areOrdered for one source node and any target.
+// A path to a target may only go through nodes before the target, so the search
+// expands the nodes in increasing order up to the largest target asked so far and
+// continues from there for a larger target.
+class ReachableSet {
+public:
+	explicit ReachableSet(int source);
+
+	int source() const { return m_source; }
+
+	// Returns areOrdered(source, target), extending the search if needed.
+	bool isOrdered(const SimpleDirectedGraph& graph, int target);
+
+	// Returns if the search already followed the successors of the node.
+	bool isExpanded(int node) const {
+		return node < m_bound && testBit(m_visited, node);
+	}
+
+	// Updates the set for an arc added to the graph. Returns false if the set cannot be
+	// updated without searching again. The set stays valid if the target was already
+	// ordered after the source, or if the arc is from an ordered node forward to a node
+	// that the search did not reach yet.
+	bool addArc(int source, int target);
+
+private:
+	static bool testBit(const std::vector<unsigned int>& bits, int node) {
+		return node / 32 < static_cast<int>(bits.size()) && ((bits[node / 32] >> (node % 32)) & 1) != 0;
+	}
+	static void setBit(std::vector<unsigned int>* bits, int node);
+
+	int m_source;
+	// All the visited nodes before m_bound are expanded.
+	int m_bound;
+	int m_maxExpanded;
+	std::vector<unsigned int> m_visited;
+	// A node is ordered after the source if it was visited while all the expanded
+	// nodes were before it.
+	std::vector<unsigned int> m_ordered;
+	// Min-heap of the visited nodes that are not expanded yet.
+	std::vector<int> m_pending;
+};
+
+// Keeps the ReachableSets of the most recently queried sources of a graph, so that
+// repeated queries from the same source do not search the graph again. At most
+// max_sources sets are kept, the least recently used one is dropped first.
+// The cache is thread-safe.
+class ReachabilityCache {
+public:
+	explicit ReachabilityCache(int max_sources);
+	~ReachabilityCache();
+
+	bool isOrdered(const SimpleDirectedGraph& graph, int source, int target);
+
+	// Must be called when an arc is added to the graph. Updates the sets that already
+	// followed the successors of the source and drops the ones that cannot be updated.
+	void addArc(int source, int target);
+	// Drops all the sets.
+	void clear();
+
+	int maxSources() const { return m_maxSources; }
+	// Queries answered from a kept set and queries that started a new set.
+	int64 numHits() const { return m_numHits; }
+	int64 numMisses() const { return m_numMisses; }
+	// Sets updated for an added arc and sets dropped because of one.
+	int64 numUpdated() const { return m_numUpdated; }
+	int64 numDropped() const { return m_numDropped; }
+
+private:
+	typedef std::list<ReachableSet*> SetList;
+
+	mutex m_mutex;
+	int m_maxSources;
+	// The most recently used set is first.
+	SetList m_sets;
+	std::map<int, SetList::iterator> m_setBySource;
+	int64 m_numHits;
+	int64 m_numMisses;
+	int64 m_numUpdated;
+	int64 m_numDropped;
+};
+
+#endif /* REACHABILITYCACHE_H_ */
@@ -16,6 +16,7 @@
 
 #include "ThreadMapping.h"
 
+#include "AnalysisProgress.h"
 #include "base.h"
 
 #include <stdio.h>
@@ -25,18 +26,28 @@
 ThreadMapping::ThreadMapping() : m_numThreads(0) {
 }
 
-void ThreadMapping::build(const SimpleDirectedGraph& graph) {
+void ThreadMapping::build(const SimpleDirectedGraph& graph, AnalysisProgress* progress) {
 	printf("ThreadMapping: Computing threads...\n");
 	int64 start_time = GetCurrentTimeMicros();
+	if (progress != NULL) progress->startStage("Chain decomposition", graph.numNodes());
 	// Greedy algorithm for mapping nodes to threads.
 	m_nodeThread.assign(graph.numNodes(), -1);
 	m_numThreads = 0;
 	for (int i = 0; i < graph.numNodes(); ++i) {
+		if (progress != NULL && !progress->update(i)) break;
 		if (m_nodeThread[i] == -1 && !graph.isNodeDeleted(i)) {
 			assignNodesToThread(graph, i, m_numThreads);
 			++m_numThreads;
 		}
 	}
+	m_threadLastNode.assign(m_numThreads, -1);
+	m_threadSize.assign(m_numThreads, 0);
+	for (int i = 0; i < graph.numNodes(); ++i) {
+		if (m_nodeThread[i] != -1) {
+			m_threadLastNode[m_nodeThread[i]] = i;
+			++m_threadSize[m_nodeThread[i]];
+		}
+	}
 	printf("ThreadMapping: Found %d threads for %lld ms\n", m_numThreads, (GetCurrentTimeMicros() - start_time) / 1000);
 }
 
@@ -96,11 +107,13 @@ void maxVector(std::vector<short>* outv, const std::vector<short>& inv) {
 }
 }  // namespace
 
-void ThreadMapping::computeVectorClocks(const SimpleDirectedGraph& graph) {
+void ThreadMapping::computeVectorClocks(const SimpleDirectedGraph& graph, AnalysisProgress* progress) {
 	printf("ThreadMapping: Computing vector clocks...\n");
 	int64 start_time = GetCurrentTimeMicros();
+	if (progress != NULL) progress->startStage("Vector clocks", graph.numNodes());
 	m_vectorClocks.assign(graph.numNodes(), std::vector<short>());
 	for (int node_id = 0; node_id < graph.numNodes(); ++node_id) {
+		if (progress != NULL && !progress->update(node_id)) break;
 		if (m_nodeThread[node_id] == -1) continue;
 		m_vectorClocks[node_id].assign(m_numThreads, 0);
 		const std::vector<int>& pred = graph.nodePredecessors(node_id);
@@ -112,8 +125,59 @@ void ThreadMapping::computeVectorClocks(const SimpleDirectedGraph& graph) {
 	printf("ThreadMapping: Vector clocks done... (%lld ms)\n", (GetCurrentTimeMicros() - start_time) / 1000);
 }
 
-bool ThreadMapping::areOrdered(int slice1, int slice2) const {
-	if (slice1 == slice2) return true;
-	if (slice2 < slice1) return false;
-	return m_vectorClocks[slice1][m_nodeThread[slice1]] <= m_vectorClocks[slice2][m_nodeThread[slice1]];
+void ThreadMapping::extend(const SimpleDirectedGraph& graph, int first_new_node) {
+	int64 start_time = GetCurrentTimeMicros();
+	int old_num_threads = m_numThreads;
+	m_nodeThread.resize(graph.numNodes(), -1);
+	m_vectorClocks.resize(graph.numNodes());
+	for (int node_id = first_new_node; node_id < graph.numNodes(); ++node_id) {
+		if (graph.isNodeDeleted(node_id)) continue;
+		const std::vector<int>& pred = graph.nodePredecessors(node_id);
+		// Continue the thread of a predecessor that is the last node in its thread.
+		int thread = -1;
+		for (size_t j = 0; j < pred.size(); ++j) {
+			int pred_thread = m_nodeThread[pred[j]];
+			if (pred_thread != -1 && m_threadLastNode[pred_thread] == pred[j] &&
+					m_threadSize[pred_thread] < 32766) {
+				thread = pred_thread;
+				break;
+			}
+		}
+		if (thread == -1) {
+			thread = m_numThreads++;
+			m_threadLastNode.push_back(-1);
+			m_threadSize.push_back(0);
+		}
+		m_nodeThread[node_id] = thread;
+		m_threadLastNode[thread] = node_id;
+		++m_threadSize[thread];
+
+		m_vectorClocks[node_id].assign(m_numThreads, 0);
+		for (size_t j = 0; j < pred.size(); ++j) {
+			maxVector(&m_vectorClocks[node_id], m_vectorClocks[pred[j]]);
+		}
+		m_vectorClocks[node_id][thread]++;
+	}
+	printf("ThreadMapping: Extended with %d nodes and %d threads (%lld ms)\n",
+			graph.numNodes() - first_new_node, m_numThreads - old_num_threads,
+			(GetCurrentTimeMicros() - start_time) / 1000);
+}
+
+size_t ThreadMapping::memoryBytes() const {
+	size_t bytes = (m_nodeThread.capacity() + m_threadLastNode.capacity() + m_threadSize.capacity()) * sizeof(int) +
+			m_vectorClocks.capacity() * sizeof(std::vector<short>);
+	for (size_t i = 0; i < m_vectorClocks.size(); ++i) {
+		bytes += m_vectorClocks[i].capacity() * sizeof(short);
+	}
+	return bytes;
+}
+
+void ThreadMapping::areOrderedBatch(const std::vector<OrderQuery>& queries, std::vector<bool>* ordered) const {
+	ordered->resize(queries.size());
+	std::vector<int> order;
+	sortQueriesByTarget(queries, &order);
+	for (size_t i = 0; i < order.size(); ++i) {
+		const OrderQuery& query = queries[order[i]];
+		(*ordered)[order[i]] = isOrdered(query.first, query.second);
+	}
 }
@@ -20,27 +20,50 @@
 #include <vector>
 #include "EventGraph.h"
 
+class AnalysisProgress;
+
 // Maps atomic pieces to threads.
 class ThreadMapping : public EventGraphInterface {
 public:
 	ThreadMapping();
-	void build(const SimpleDirectedGraph& graph);
+	// Both build and computeVectorClocks report to progress (if not NULL) and stop early
+	// if the analysis must stop. The result is not usable in this case.
+	void build(const SimpleDirectedGraph& graph, AnalysisProgress* progress = NULL);
 
-	void computeVectorClocks(const SimpleDirectedGraph& graph);
+	void computeVectorClocks(const SimpleDirectedGraph& graph, AnalysisProgress* progress = NULL);
 
 	int num_threads() const { return m_numThreads; }
+	// The memory allocated for the threads and the vector clocks.
+	size_t memoryBytes() const;
 
-	virtual bool areOrdered(int slice1, int slice2) const;
+	virtual bool areOrdered(int slice1, int slice2) const {
+		return isOrdered(slice1, slice2);
+	}
+	// Answers the queries in the order of their targets, reading every vector clock once.
+	virtual void areOrderedBatch(const std::vector<OrderQuery>& queries, std::vector<bool>* ordered) const;
+	// Assigns the new nodes to threads and computes their vector clocks. The vector clocks
+	// of the older nodes are not resized, they are shorter than the new ones.
+	virtual void extend(const SimpleDirectedGraph& graph, int first_new_node);
 
 //	const std::vector<int>& getClockForSlice(int slice) const {
 //		return m_vectorClocks[slice];
 //	}
 
+	// Same as areOrdered, but inlined into the loops that are templated on the backend.
+	bool isOrdered(int slice1, int slice2) const {
+		if (slice1 == slice2) return true;
+		if (slice2 < slice1) return false;
+		return m_vectorClocks[slice1][m_nodeThread[slice1]] <= m_vectorClocks[slice2][m_nodeThread[slice1]];
+	}
+
 private:
 	void assignNodesToThread(const SimpleDirectedGraph& graph, int startNode, int threadId);
 
 	std::vector<int> m_nodeThread;
 	int m_numThreads;
+	// The last node and the number of nodes of every thread.
+	std::vector<int> m_threadLastNode;
+	std::vector<int> m_threadSize;
 
 	std::vector<std::vector<short> > m_vectorClocks;
 };
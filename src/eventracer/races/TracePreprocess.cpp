@@ -18,83 +18,162 @@
 
 #include <stddef.h>
 #include <stdio.h>
-#include <sstream>
+#include <algorithm>
 #include <map>
+#include <set>
+
+namespace {
+// Sets patterns to the patterns that occur in the locations read or written by op, in
+// increasing order.
+void FindMatchedPatterns(const LocationPatterns& location_patterns, const ActionLog::EventAction& op,
+                         std::vector<int>* patterns) {
+    patterns->clear();
+    for (size_t cmd_id = 0; cmd_id < op.m_commands.size(); ++cmd_id) {
+        const ActionLog::Command& cmd = op.m_commands[cmd_id];
+        if (cmd.m_cmdType != ActionLog::READ_MEMORY && cmd.m_cmdType != ActionLog::WRITE_MEMORY) continue;
+        if (!location_patterns.matchesAny(cmd.m_location)) continue;
+        const std::vector<int>& matched = location_patterns.matchedPatterns(cmd.m_location);
+        patterns->insert(patterns->end(), matched.begin(), matched.end());
+    }
+    std::sort(patterns->begin(), patterns->end());
+    patterns->erase(std::unique(patterns->begin(), patterns->end()), patterns->end());
+}
+}  // namespace
 
-// Filter commutative lazy init of pattern x = x || ?
-void TracePreprocess::RemoveCommutativeLazyInit(const std::string& location) {
+void TracePreprocess::RemovePatterns(const std::vector<std::string>& ignored_locations,
+                                     const std::vector<std::string>& lazy_init_locations) {
+    std::map<int, int> global_locals;
+    std::map<int, bool> pure_incrementations;
+    std::map<int, int> constant_values;
+    std::set<int> has_skipped_first_write;
+
+    LocationPatterns ignored(ignored_locations);
+    ignored.match(*m_vars);
+    LocationPatterns lazy_init(lazy_init_locations);
+    lazy_init.match(*m_vars);
+    std::vector<int> op_patterns;
 
     int num_ops = m_log->maxEventActionId()  + 1;
-    for (int op_id = 0; op_id < num_ops; ++op_id) {
 
+    // Each filter works on the trace left by the previous filters. The filters without
+    // state for the whole trace and the analysis of the next filter run in the same sweep.
+    for (int op_id = 0; op_id < num_ops; ++op_id) {
         if (m_log->event_action(op_id).m_commands.empty()) continue;  // Avoid adding event actions.
         ActionLog::EventAction* op = m_log->mutable_event_action(op_id);
+        // Only the patterns in the locations of the event action can remove commands from it.
+        FindMatchedPatterns(ignored, *op, &op_patterns);
+        for (size_t i = 0; i < op_patterns.size(); ++i) {
+            if (ignored_locations[op_patterns[i]].compare("") == 0) continue;
+            if (IgnoreLocation(ignored, op_patterns[i], op)) RemoveEmptyOperations(op);
+        }
+        FindMatchedPatterns(lazy_init, *op, &op_patterns);
+        for (size_t i = 0; i < op_patterns.size(); ++i) {
+            if (RemoveCommutativeLazyInit(lazy_init, op_patterns[i], op)) RemoveEmptyOperations(op);
+        }
+        FindGlobalLocals(op_id, *op, &global_locals);
+    }
 
-        for (size_t cmd_id = 3; cmd_id < op->m_commands.size(); ++cmd_id) {
-
-            ActionLog::Command& cmd0 = op->m_commands[cmd_id - 3];
-            if (cmd0.m_cmdType != ActionLog::READ_MEMORY) continue;
-            ActionLog::Command& cmd1 = op->m_commands[cmd_id - 2];
-            if (cmd1.m_cmdType != ActionLog::MEMORY_VALUE) continue;
+    for (int op_id = 0; op_id < num_ops; ++op_id) {
+        if (m_log->event_action(op_id).m_commands.empty()) continue;  // Avoid adding event actions.
+        ActionLog::EventAction* op = m_log->mutable_event_action(op_id);
+        if (RemoveGlobalLocals(global_locals, op)) RemoveEmptyOperations(op);
+        FindPureIncrementations(*op, &pure_incrementations);
+    }
 
-            ActionLog::Command& cmd2 = op->m_commands[cmd_id - 1];
-            if (cmd2.m_cmdType != ActionLog::WRITE_MEMORY) continue;
-            if (cmd2.m_location != cmd0.m_location) continue;
-            ActionLog::Command& cmd3 = op->m_commands[cmd_id - 0];
-            if (cmd3.m_cmdType != ActionLog::MEMORY_VALUE) continue;
-            if (cmd3.m_location != cmd1.m_location) continue;
+    for (int op_id = 0; op_id < num_ops; ++op_id) {
+        if (m_log->event_action(op_id).m_commands.empty()) continue;  // Avoid adding event actions.
+        ActionLog::EventAction* op = m_log->mutable_event_action(op_id);
+        if (RemovePureIncrementation(pure_incrementations, op)) RemoveEmptyOperations(op);
+        FindConstantValues(*op, &constant_values);
+    }
 
-            int memory_location = cmd0.m_location;
-            std::string memory_location_str = m_vars->getString(memory_location);
+    for (int op_id = 0; op_id < num_ops; ++op_id) {
+        if (m_log->event_action(op_id).m_commands.empty()) continue;  // Avoid adding event actions.
+        ActionLog::EventAction* op = m_log->mutable_event_action(op_id);
+        if (RemoveConstantValue(constant_values, &has_skipped_first_write, op)) RemoveEmptyOperations(op);
+    }
+}
 
-            if (memory_location_str.find(location) == std::string::npos) continue;
+// Filter commutative lazy init of pattern x = x || ?
+void TracePreprocess::RemoveCommutativeLazyInit(const std::string& location) {
 
-            std::string memory_value = m_values->getString(cmd1.m_location);
+    LocationPatterns lazy_init(std::vector<std::string>(1, location));
+    lazy_init.match(*m_vars);
 
-            if (memory_value.compare("undefined") == 0 ||
-                    memory_value.compare("false") == 0 ||
-                    memory_value.compare("null") == 0 ||
-                    memory_value.compare("\"\"") == 0 ||
-                    memory_value.compare("0") == 0) continue;
+    int num_ops = m_log->maxEventActionId()  + 1;
+    for (int op_id = 0; op_id < num_ops; ++op_id) {
 
-            // Mark the write operation for deletion, such that it commutes with any other non-writing operation
-            cmd2.m_cmdType = cmd3.m_cmdType = static_cast<ActionLog::CommandType>(-1);
-        }
+        if (m_log->event_action(op_id).m_commands.empty()) continue;  // Avoid adding event actions.
+        RemoveCommutativeLazyInit(lazy_init, 0, m_log->mutable_event_action(op_id));
     }
 
     RemoveEmptyOperations();
 
 }
 
+bool TracePreprocess::RemoveCommutativeLazyInit(const LocationPatterns& lazy_init, int pattern,
+                                                ActionLog::EventAction* op) const {
+    bool removed = false;
+    for (size_t cmd_id = 3; cmd_id < op->m_commands.size(); ++cmd_id) {
+
+        ActionLog::Command& cmd0 = op->m_commands[cmd_id - 3];
+        if (cmd0.m_cmdType != ActionLog::READ_MEMORY) continue;
+        ActionLog::Command& cmd1 = op->m_commands[cmd_id - 2];
+        if (cmd1.m_cmdType != ActionLog::MEMORY_VALUE) continue;
+
+        ActionLog::Command& cmd2 = op->m_commands[cmd_id - 1];
+        if (cmd2.m_cmdType != ActionLog::WRITE_MEMORY) continue;
+        if (cmd2.m_location != cmd0.m_location) continue;
+        ActionLog::Command& cmd3 = op->m_commands[cmd_id - 0];
+        if (cmd3.m_cmdType != ActionLog::MEMORY_VALUE) continue;
+        if (cmd3.m_location != cmd1.m_location) continue;
+
+        if (!lazy_init.matches(cmd0.m_location, pattern)) continue;
+
+        if (m_valueTable.isFalsy(cmd1.m_location)) continue;
+
+        // Mark the write operation for deletion, such that it commutes with any other non-writing operation
+        cmd2.m_cmdType = cmd3.m_cmdType = static_cast<ActionLog::CommandType>(-1);
+        removed = true;
+    }
+    return removed;
+}
+
 void TracePreprocess::IgnoreLocation(const std::string& location) {
 
     if (location.compare("") == 0) {
         return;
     }
 
+    LocationPatterns ignored(std::vector<std::string>(1, location));
+    ignored.match(*m_vars);
+
     int num_ops = m_log->maxEventActionId()  + 1;
 
     for (int op_id = 0; op_id < num_ops; ++op_id) {
         if (m_log->event_action(op_id).m_commands.empty()) continue;  // Avoid adding event actions.
-        ActionLog::EventAction* op = m_log->mutable_event_action(op_id);
-
-        for (size_t cmd_id = 1; cmd_id < op->m_commands.size(); ++cmd_id) {
-            ActionLog::Command& cmd0 = op->m_commands[cmd_id - 1];
-            if (cmd0.m_cmdType != ActionLog::READ_MEMORY && cmd0.m_cmdType != ActionLog::WRITE_MEMORY) continue;
-            ActionLog::Command& cmd1 = op->m_commands[cmd_id - 0];
-            if (cmd1.m_cmdType != ActionLog::MEMORY_VALUE) continue;
+        IgnoreLocation(ignored, 0, m_log->mutable_event_action(op_id));
+    }
 
-            int memory_location = cmd0.m_location;
-            std::string memory_location_str = m_vars->getString(memory_location);
+    RemoveEmptyOperations();
+}
 
-            if (memory_location_str.find(location) != std::string::npos) {
-                // Mark the operation for deletions.
-                cmd0.m_cmdType = cmd1.m_cmdType = static_cast<ActionLog::CommandType>(-1);
-            }
+bool TracePreprocess::IgnoreLocation(const LocationPatterns& ignored, int pattern,
+                                     ActionLog::EventAction* op) const {
+    bool removed = false;
+    for (size_t cmd_id = 1; cmd_id < op->m_commands.size(); ++cmd_id) {
+        ActionLog::Command& cmd0 = op->m_commands[cmd_id - 1];
+        if (cmd0.m_cmdType != ActionLog::READ_MEMORY && cmd0.m_cmdType != ActionLog::WRITE_MEMORY) continue;
+        ActionLog::Command& cmd1 = op->m_commands[cmd_id - 0];
+        if (cmd1.m_cmdType != ActionLog::MEMORY_VALUE) continue;
+
+        if (ignored.matches(cmd0.m_location, pattern)) {
+            // Mark the operation for deletions.
+            cmd0.m_cmdType = cmd1.m_cmdType = static_cast<ActionLog::CommandType>(-1);
+            removed = true;
         }
     }
-
-    RemoveEmptyOperations();
+    return removed;
 }
 
 void TracePreprocess::RemoveGlobalLocals() {
@@ -106,62 +185,70 @@ void TracePreprocess::RemoveGlobalLocals() {
 
     for (int op_id = 0; op_id < num_ops; ++op_id) {
         if (m_log->event_action(op_id).m_commands.empty()) continue;  // Avoid adding event actions.
-        ActionLog::EventAction* op = m_log->mutable_event_action(op_id);
-
-        for (size_t cmd_id = 0; cmd_id < op->m_commands.size(); ++cmd_id) {
-            ActionLog::Command& cmd0 = op->m_commands[cmd_id];
-            if (cmd0.m_cmdType != ActionLog::READ_MEMORY && cmd0.m_cmdType != ActionLog::WRITE_MEMORY) continue;
-            //ActionLog::Command& cmd1 = op->m_commands[cmd_id - 0];
-            //if (cmd1.m_cmdType != ActionLog::MEMORY_VALUE) continue;
-
-            int memory_location = cmd0.m_location;
-            const char* memory_location_char = m_vars->getString(memory_location);
-
-            if (*memory_location_char != 'O' &&
-                    *memory_location_char != 'A' &&
-                    *memory_location_char != 'W') continue; // only analyze objects and arrays and globals (Window)
-
-            if (cmd0.m_cmdType == ActionLog::READ_MEMORY &&
-                    (safe_to_remove.find(memory_location) == safe_to_remove.end() ||
-                    safe_to_remove[memory_location] != op_id)) {
-                // Either a read of an uninitialized value or a read of a value from another operation.
-                // Mark the write operation as unsafe for removal.
-                safe_to_remove[memory_location] = -1;
-            } else {
-                safe_to_remove[memory_location] = op_id;  // record the last operation to access this memory location
-            }
-        }
+        FindGlobalLocals(op_id, m_log->event_action(op_id), &safe_to_remove);
     }
 
     // Remove
 
     for (int op_id = 0; op_id < num_ops; ++op_id) {
         if (m_log->event_action(op_id).m_commands.empty()) continue;  // Avoid adding event actions.
-        ActionLog::EventAction* op = m_log->mutable_event_action(op_id);
+        RemoveGlobalLocals(safe_to_remove, m_log->mutable_event_action(op_id));
+    }
 
-        for (size_t cmd_id = 0; cmd_id < op->m_commands.size(); ++cmd_id) {
-            ActionLog::Command& cmd0 = op->m_commands[cmd_id];
-            if (cmd0.m_cmdType != ActionLog::READ_MEMORY && cmd0.m_cmdType != ActionLog::WRITE_MEMORY) continue;
+    RemoveEmptyOperations();
+}
 
-            int memory_location = cmd0.m_location;
+void TracePreprocess::FindGlobalLocals(int op_id, const ActionLog::EventAction& op,
+                                       std::map<int, int>* safe_to_remove) const {
+    for (size_t cmd_id = 0; cmd_id < op.m_commands.size(); ++cmd_id) {
+        const ActionLog::Command& cmd0 = op.m_commands[cmd_id];
+        if (cmd0.m_cmdType != ActionLog::READ_MEMORY && cmd0.m_cmdType != ActionLog::WRITE_MEMORY) continue;
+        //ActionLog::Command& cmd1 = op->m_commands[cmd_id - 0];
+        //if (cmd1.m_cmdType != ActionLog::MEMORY_VALUE) continue;
+
+        int memory_location = cmd0.m_location;
+
+        // only analyze objects and arrays and globals (Window)
+        if (!m_varClasses.is(memory_location,
+                LocationClasses::OBJECT | LocationClasses::ARRAY | LocationClasses::WINDOW)) continue;
+
+        if (cmd0.m_cmdType == ActionLog::READ_MEMORY &&
+                (safe_to_remove->find(memory_location) == safe_to_remove->end() ||
+                (*safe_to_remove)[memory_location] != op_id)) {
+            // Either a read of an uninitialized value or a read of a value from another operation.
+            // Mark the write operation as unsafe for removal.
+            (*safe_to_remove)[memory_location] = -1;
+        } else {
+            (*safe_to_remove)[memory_location] = op_id;  // record the last operation to access this memory location
+        }
+    }
+}
 
-            if (safe_to_remove.find(memory_location) != safe_to_remove.end() &&
-                safe_to_remove[memory_location] != -1) {
+bool TracePreprocess::RemoveGlobalLocals(const std::map<int, int>& safe_to_remove,
+                                         ActionLog::EventAction* op) const {
+    bool removed = false;
+    for (size_t cmd_id = 0; cmd_id < op->m_commands.size(); ++cmd_id) {
+        ActionLog::Command& cmd0 = op->m_commands[cmd_id];
+        if (cmd0.m_cmdType != ActionLog::READ_MEMORY && cmd0.m_cmdType != ActionLog::WRITE_MEMORY) continue;
 
-                // Mark the operation for deletions.
-                cmd0.m_cmdType = static_cast<ActionLog::CommandType>(-1);
+        int memory_location = cmd0.m_location;
+
+        std::map<int, int>::const_iterator it = safe_to_remove.find(memory_location);
+        if (it != safe_to_remove.end() && it->second != -1) {
 
-                if (cmd_id+1 < op->m_commands.size()) {
-                    ActionLog::Command& cmd1 = op->m_commands[cmd_id+1];
-                    if (cmd1.m_cmdType != ActionLog::MEMORY_VALUE) continue;
+            // Mark the operation for deletions.
+            cmd0.m_cmdType = static_cast<ActionLog::CommandType>(-1);
+            removed = true;
 
-                    cmd1.m_cmdType = static_cast<ActionLog::CommandType>(-1);
-                }
+            if (cmd_id+1 < op->m_commands.size()) {
+                ActionLog::Command& cmd1 = op->m_commands[cmd_id+1];
+                if (cmd1.m_cmdType != ActionLog::MEMORY_VALUE) continue;
+
+                cmd1.m_cmdType = static_cast<ActionLog::CommandType>(-1);
             }
         }
     }
-
-    RemoveEmptyOperations();
+    return removed;
 }
 
 void TracePreprocess::RemovePureIncrementation() {
@@ -173,92 +260,93 @@ void TracePreprocess::RemovePureIncrementation() {
 
     for (int op_id = 0; op_id < num_ops; ++op_id) {
         if (m_log->event_action(op_id).m_commands.empty()) continue;  // Avoid adding event actions.
-        ActionLog::EventAction* op = m_log->mutable_event_action(op_id);
+        FindPureIncrementations(m_log->event_action(op_id), &safe_to_remove);
+    }
 
-        for (size_t cmd_id = 1; cmd_id < op->m_commands.size(); ++cmd_id) {
-            ActionLog::Command& cmd0 = op->m_commands[cmd_id - 1];
-            if (cmd0.m_cmdType != ActionLog::READ_MEMORY) continue;
-            ActionLog::Command& cmd1 = op->m_commands[cmd_id - 0];
-            if (cmd1.m_cmdType != ActionLog::MEMORY_VALUE) continue;
+    // Remove
 
-            // if we see a read, then it must be followed by a write on the same location
+    for (int op_id = 0; op_id < num_ops; ++op_id) {
+        if (m_log->event_action(op_id).m_commands.empty()) continue;  // Avoid adding event actions.
+        RemovePureIncrementation(safe_to_remove, m_log->mutable_event_action(op_id));
+    }
 
-            if (cmd_id+2 >= op->m_commands.size()) {
-                // no write, mark as invalid
-                safe_to_remove[cmd0.m_location] = false;
-            }
+    RemoveEmptyOperations();
+}
 
-            ActionLog::Command& cmd2 = op->m_commands[cmd_id + 1];
-            ActionLog::Command& cmd3 = op->m_commands[cmd_id + 2];
-            if (cmd2.m_cmdType != ActionLog::WRITE_MEMORY ||
-                    cmd3.m_cmdType != ActionLog::MEMORY_VALUE ||
-                    cmd2.m_location != cmd0.m_location) {
-                // no write or the is not to the same memory location
-                safe_to_remove[cmd0.m_location] = false;
-                continue;
-            }
+void TracePreprocess::FindPureIncrementations(const ActionLog::EventAction& op,
+                                              std::map<int, bool>* safe_to_remove) const {
+    for (size_t cmd_id = 1; cmd_id < op.m_commands.size(); ++cmd_id) {
+        const ActionLog::Command& cmd0 = op.m_commands[cmd_id - 1];
+        if (cmd0.m_cmdType != ActionLog::READ_MEMORY) continue;
+        const ActionLog::Command& cmd1 = op.m_commands[cmd_id - 0];
+        if (cmd1.m_cmdType != ActionLog::MEMORY_VALUE) continue;
 
-            int memory_location = cmd0.m_location;
-            const char* memory_location_char = m_vars->getString(memory_location);
+        // if we see a read, then it must be followed by a write on the same location
 
-            // only analyze objects, arrays, globals (Window) and JS activation objects
-            if (*memory_location_char != 'O' &&
-                    *memory_location_char != 'A' &&
-                    *memory_location_char != 'W' &&
-                    *memory_location_char != 'J') continue;
+        if (cmd_id+2 >= op.m_commands.size()) {
+            // no write, mark as invalid
+            (*safe_to_remove)[cmd0.m_location] = false;
+        }
 
-            if (safe_to_remove.find(memory_location) == safe_to_remove.end()) {
-                safe_to_remove[memory_location] = true;
-            }
+        const ActionLog::Command& cmd2 = op.m_commands[cmd_id + 1];
+        const ActionLog::Command& cmd3 = op.m_commands[cmd_id + 2];
+        if (cmd2.m_cmdType != ActionLog::WRITE_MEMORY ||
+                cmd3.m_cmdType != ActionLog::MEMORY_VALUE ||
+                cmd2.m_location != cmd0.m_location) {
+            // no write or the is not to the same memory location
+            (*safe_to_remove)[cmd0.m_location] = false;
+            continue;
+        }
 
-            if (safe_to_remove[memory_location] == true) {
+        int memory_location = cmd0.m_location;
 
-                std::string mem_value1 = m_values->getString(cmd1.m_location);
-                std::string mem_value2 = m_values->getString(cmd3.m_location);
+        // only analyze objects, arrays, globals (Window) and JS activation objects
+        if (!m_varClasses.is(memory_location,
+                LocationClasses::OBJECT | LocationClasses::ARRAY | LocationClasses::WINDOW |
+                LocationClasses::JS_ACTIVATION)) continue;
 
-                int mem_value1_int;
-                std::istringstream(mem_value1) >> mem_value1_int;
+        if (safe_to_remove->find(memory_location) == safe_to_remove->end()) {
+            (*safe_to_remove)[memory_location] = true;
+        }
 
-                int mem_value2_int;
-                std::istringstream(mem_value2) >> mem_value2_int;
+        if ((*safe_to_remove)[memory_location] == true) {
 
-                // is this an incrementation
-                safe_to_remove[memory_location] = (mem_value1_int == mem_value2_int - 1);
+            int mem_value1_int = m_valueTable.leadingInt(cmd1.m_location);
+            int mem_value2_int = m_valueTable.leadingInt(cmd3.m_location);
+
+            // is this an incrementation
+            (*safe_to_remove)[memory_location] = (mem_value1_int == mem_value2_int - 1);
 
-            }
         }
     }
+}
 
-    // Remove
-
-    for (int op_id = 0; op_id < num_ops; ++op_id) {
-        if (m_log->event_action(op_id).m_commands.empty()) continue;  // Avoid adding event actions.
-        ActionLog::EventAction* op = m_log->mutable_event_action(op_id);
-
-        for (size_t cmd_id = 1; cmd_id < op->m_commands.size(); ++cmd_id) {
-            ActionLog::Command& cmd0 = op->m_commands[cmd_id - 1];
-            if (cmd0.m_cmdType != ActionLog::READ_MEMORY && cmd0.m_cmdType != ActionLog::WRITE_MEMORY) continue;
-            ActionLog::Command& cmd1 = op->m_commands[cmd_id - 0];
-            if (cmd1.m_cmdType != ActionLog::MEMORY_VALUE) continue;
+bool TracePreprocess::RemovePureIncrementation(const std::map<int, bool>& safe_to_remove,
+                                               ActionLog::EventAction* op) const {
+    bool removed = false;
+    for (size_t cmd_id = 1; cmd_id < op->m_commands.size(); ++cmd_id) {
+        ActionLog::Command& cmd0 = op->m_commands[cmd_id - 1];
+        if (cmd0.m_cmdType != ActionLog::READ_MEMORY && cmd0.m_cmdType != ActionLog::WRITE_MEMORY) continue;
+        ActionLog::Command& cmd1 = op->m_commands[cmd_id - 0];
+        if (cmd1.m_cmdType != ActionLog::MEMORY_VALUE) continue;
 
-            int memory_location = cmd0.m_location;
+        int memory_location = cmd0.m_location;
 
-            if (safe_to_remove.find(memory_location) != safe_to_remove.end() &&
-                safe_to_remove[memory_location] == true) {
+        std::map<int, bool>::const_iterator it = safe_to_remove.find(memory_location);
+        if (it != safe_to_remove.end() && it->second == true) {
 
-                // Mark the operation for deletions.
-                cmd0.m_cmdType = cmd1.m_cmdType = static_cast<ActionLog::CommandType>(-1);
-            }
+            // Mark the operation for deletions.
+            cmd0.m_cmdType = cmd1.m_cmdType = static_cast<ActionLog::CommandType>(-1);
+            removed = true;
         }
     }
-
-    RemoveEmptyOperations();
+    return removed;
 }
 
 void TracePreprocess::RemoveConstantValue() {
 
     std::map<int, int> safe_to_remove;
-    std::map<int, bool> has_skipped_first_write;
+    std::set<int> has_skipped_first_write;
 
     int num_ops = m_log->maxEventActionId()  + 1;
 
@@ -266,57 +354,67 @@ void TracePreprocess::RemoveConstantValue() {
 
     for (int op_id = 0; op_id < num_ops; ++op_id) {
         if (m_log->event_action(op_id).m_commands.empty()) continue;  // Avoid adding event actions.
-        ActionLog::EventAction* op = m_log->mutable_event_action(op_id);
+        FindConstantValues(m_log->event_action(op_id), &safe_to_remove);
+    }
 
-        for (size_t cmd_id = 1; cmd_id < op->m_commands.size(); ++cmd_id) {
-            ActionLog::Command& cmd0 = op->m_commands[cmd_id - 1];
-            if (cmd0.m_cmdType != ActionLog::READ_MEMORY && cmd0.m_cmdType != ActionLog::WRITE_MEMORY) continue;
-            ActionLog::Command& cmd1 = op->m_commands[cmd_id - 0];
-            if (cmd1.m_cmdType != ActionLog::MEMORY_VALUE) continue;
+    // Remove
 
-            // if we see a read, then it must be followed by a write on the same location
+    for (int op_id = 0; op_id < num_ops; ++op_id) {
+        if (m_log->event_action(op_id).m_commands.empty()) continue;  // Avoid adding event actions.
+        RemoveConstantValue(safe_to_remove, &has_skipped_first_write, m_log->mutable_event_action(op_id));
+    }
 
-            int memory_location = cmd0.m_location;
-            int memory_value = cmd1.m_location;
+    RemoveEmptyOperations();
+}
 
-            if (safe_to_remove.find(memory_location) != safe_to_remove.end() &&
-                    safe_to_remove[memory_location] != memory_value) {
-                safe_to_remove[memory_location] = -1;
-                continue;
-            }
+void TracePreprocess::FindConstantValues(const ActionLog::EventAction& op,
+                                         std::map<int, int>* safe_to_remove) const {
+    for (size_t cmd_id = 1; cmd_id < op.m_commands.size(); ++cmd_id) {
+        const ActionLog::Command& cmd0 = op.m_commands[cmd_id - 1];
+        if (cmd0.m_cmdType != ActionLog::READ_MEMORY && cmd0.m_cmdType != ActionLog::WRITE_MEMORY) continue;
+        const ActionLog::Command& cmd1 = op.m_commands[cmd_id - 0];
+        if (cmd1.m_cmdType != ActionLog::MEMORY_VALUE) continue;
 
-            safe_to_remove[memory_location] = memory_value;
-        }
-    }
+        // if we see a read, then it must be followed by a write on the same location
 
-    // Remove
+        int memory_location = cmd0.m_location;
+        int memory_value = cmd1.m_location;
 
-    for (int op_id = 0; op_id < num_ops; ++op_id) {
-        if (m_log->event_action(op_id).m_commands.empty()) continue;  // Avoid adding event actions.
-        ActionLog::EventAction* op = m_log->mutable_event_action(op_id);
+        if (safe_to_remove->find(memory_location) != safe_to_remove->end() &&
+                (*safe_to_remove)[memory_location] != memory_value) {
+            (*safe_to_remove)[memory_location] = -1;
+            continue;
+        }
 
-        for (size_t cmd_id = 1; cmd_id < op->m_commands.size(); ++cmd_id) {
-            ActionLog::Command& cmd0 = op->m_commands[cmd_id - 1];
-            if (cmd0.m_cmdType != ActionLog::WRITE_MEMORY) continue;
-            ActionLog::Command& cmd1 = op->m_commands[cmd_id - 0];
-            if (cmd1.m_cmdType != ActionLog::MEMORY_VALUE) continue;
+        (*safe_to_remove)[memory_location] = memory_value;
+    }
+}
 
-            int memory_location = cmd0.m_location;
+bool TracePreprocess::RemoveConstantValue(const std::map<int, int>& safe_to_remove,
+                                          std::set<int>* has_skipped_first_write,
+                                          ActionLog::EventAction* op) const {
+    bool removed = false;
+    for (size_t cmd_id = 1; cmd_id < op->m_commands.size(); ++cmd_id) {
+        ActionLog::Command& cmd0 = op->m_commands[cmd_id - 1];
+        if (cmd0.m_cmdType != ActionLog::WRITE_MEMORY) continue;
+        ActionLog::Command& cmd1 = op->m_commands[cmd_id - 0];
+        if (cmd1.m_cmdType != ActionLog::MEMORY_VALUE) continue;
 
-            if (safe_to_remove.find(memory_location) != safe_to_remove.end() &&
-                safe_to_remove[memory_location] != -1) {
+        int memory_location = cmd0.m_location;
 
-                if (has_skipped_first_write.find(memory_location) == has_skipped_first_write.end()) {
-                    has_skipped_first_write[memory_location] = true;
-                } else {
-                    // Mark the operation for deletions.
-                    cmd0.m_cmdType = cmd1.m_cmdType = static_cast<ActionLog::CommandType>(-1);
-                }
+        std::map<int, int>::const_iterator it = safe_to_remove.find(memory_location);
+        if (it != safe_to_remove.end() && it->second != -1) {
+
+            if (has_skipped_first_write->insert(memory_location).second) {
+                // Keep the first write.
+            } else {
+                // Mark the operation for deletions.
+                cmd0.m_cmdType = cmd1.m_cmdType = static_cast<ActionLog::CommandType>(-1);
+                removed = true;
             }
         }
     }
-
-    RemoveEmptyOperations();
+    return removed;
 }
 
 void TracePreprocess::RemoveEmptyReadWrites() {
@@ -443,19 +541,22 @@ void TracePreprocess::RemoveEmptyOperations() {
 	int num_ops = m_log->maxEventActionId()  + 1;
 	for (int op_id = 0; op_id < num_ops; ++op_id) {
 		if (m_log->event_action(op_id).m_commands.empty()) continue;  // Avoid adding event actions.
-		ActionLog::EventAction* op = m_log->mutable_event_action(op_id);
-		size_t new_cmd_id = 0;
-		for (size_t cmd_id = 0; cmd_id < op->m_commands.size(); ++cmd_id) {
-			const ActionLog::Command& cmd = op->m_commands[cmd_id];
-			if (cmd_id != new_cmd_id) {
-				op->m_commands[new_cmd_id] = cmd;
-			}
-			if (cmd.m_cmdType != -1) {
-				++new_cmd_id;
-			}
+		RemoveEmptyOperations(m_log->mutable_event_action(op_id));
+	}
+}
+
+void TracePreprocess::RemoveEmptyOperations(ActionLog::EventAction* op) {
+	size_t new_cmd_id = 0;
+	for (size_t cmd_id = 0; cmd_id < op->m_commands.size(); ++cmd_id) {
+		const ActionLog::Command& cmd = op->m_commands[cmd_id];
+		if (cmd_id != new_cmd_id) {
+			op->m_commands[new_cmd_id] = cmd;
+		}
+		if (cmd.m_cmdType != -1) {
+			++new_cmd_id;
 		}
-		op->m_commands.erase(op->m_commands.begin() + new_cmd_id, op->m_commands.end());
 	}
+	op->m_commands.erase(op->m_commands.begin() + new_cmd_id, op->m_commands.end());
 }
 
 
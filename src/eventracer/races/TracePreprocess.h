@@ -18,9 +18,15 @@
 #ifndef TRACEPREPROCESS_H_
 #define TRACEPREPROCESS_H_
 
+#include <map>
+#include <set>
 #include <string>
+#include <vector>
 
 #include "ActionLog.h"
+#include "LocationClasses.h"
+#include "LocationPatterns.h"
+#include "MemoryValues.h"
 #include "StringSet.h"
 
 class TracePreprocess {
@@ -28,12 +34,21 @@ public:
     TracePreprocess(ActionLog* log, const StringSet* vars, const StringSet* values)
         : m_log(log),
           m_vars(vars),
-          m_values(values) {}
+          m_values(values),
+          m_varClasses(*vars),
+          m_valueTable(*values) {}
 
 	virtual ~TracePreprocess() {}
 
 	// Remove patterns:
 
+    // Same as IgnoreLocation for each of ignored_locations, then RemoveCommutativeLazyInit for
+    // each of lazy_init_locations, then RemoveGlobalLocals, RemovePureIncrementation and
+    // RemoveConstantValue, but in four sweeps over the trace. A filter that needs the whole
+    // trace analyzed runs in the sweep after its analysis.
+    void RemovePatterns(const std::vector<std::string>& ignored_locations,
+                        const std::vector<std::string>& lazy_init_locations);
+
     // Ignores specific locations declared through the commandline.
     void IgnoreLocation(const std::string& location);
 
@@ -64,11 +79,30 @@ public:
 	void RemoveUpdatesInSameMethod();
 
 private:
+    // The filters applied to one event action. They mark the removed commands and return
+    // whether they marked any.
+    // Filter the locations that contain the given pattern of ignored or lazy_init.
+    bool IgnoreLocation(const LocationPatterns& ignored, int pattern, ActionLog::EventAction* op) const;
+    bool RemoveCommutativeLazyInit(const LocationPatterns& lazy_init, int pattern,
+                                   ActionLog::EventAction* op) const;
+    void FindGlobalLocals(int op_id, const ActionLog::EventAction& op,
+                          std::map<int, int>* safe_to_remove) const;
+    bool RemoveGlobalLocals(const std::map<int, int>& safe_to_remove, ActionLog::EventAction* op) const;
+    void FindPureIncrementations(const ActionLog::EventAction& op, std::map<int, bool>* safe_to_remove) const;
+    bool RemovePureIncrementation(const std::map<int, bool>& safe_to_remove, ActionLog::EventAction* op) const;
+    void FindConstantValues(const ActionLog::EventAction& op, std::map<int, int>* safe_to_remove) const;
+    bool RemoveConstantValue(const std::map<int, int>& safe_to_remove,
+                             std::set<int>* has_skipped_first_write,
+                             ActionLog::EventAction* op) const;
+
 	void RemoveEmptyOperations();
+	static void RemoveEmptyOperations(ActionLog::EventAction* op);
 
 	ActionLog* m_log;
     const StringSet* m_vars;
     const StringSet* m_values;
+    LocationClasses m_varClasses;
+    MemoryValues m_valueTable;
 };
 
 #endif /* TRACEPREPROCESS_H_ */
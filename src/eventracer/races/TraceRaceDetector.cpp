@@ -0,0 +1,134 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "TraceRaceDetector.h"
+
+#include "ActionLog.h"
+#include "AnalysisProgress.h"
+#include "EventGraph.h"
+
+TraceRaceDetector::TraceRaceDetector(const EventGraphInterface& graph, int window)
+	: m_graph(graph), m_window(window) {
+}
+
+TraceRaceDetector::VarState& TraceRaceDetector::getVarState(int var_id) {
+	if (var_id >= static_cast<int>(m_vars.size())) {
+		m_vars.resize(var_id + 1);
+	}
+	return m_vars[var_id];
+}
+
+bool TraceRaceDetector::findRaces(const ActionLog& actions, VarsInfo::AllRaces* races,
+		AnalysisProgress* progress) {
+	if (progress != NULL) progress->startStage("Race detection", actions.maxEventActionId() + 1);
+	for (int opid = 0; opid <= actions.maxEventActionId(); ++opid) {
+		if (progress != NULL && !progress->update(opid)) return false;
+		addEventAction(actions, opid, races);
+	}
+	return true;
+}
+
+void TraceRaceDetector::addEventAction(const ActionLog& actions, int opid, VarsInfo::AllRaces* races) {
+	const ActionLog::EventAction& op = actions.event_action(opid);
+
+	// The type of an access depends on the other accesses to the variable in the event action.
+	for (size_t cmdid = 0; cmdid < op.m_commands.size(); ++cmdid) {
+		const ActionLog::Command& cmd = op.m_commands[cmdid];
+		if (cmd.m_cmdType != ActionLog::READ_MEMORY && cmd.m_cmdType != ActionLog::WRITE_MEMORY) continue;
+		VarState& var = getVarState(cmd.m_location);
+		if (var.m_eventActionId != opid) {
+			var.m_eventActionId = opid;
+			var.m_firstReadInEvent = -1;
+			var.m_lastWriteInEvent = -1;
+		}
+		if (cmd.m_cmdType == ActionLog::READ_MEMORY) {
+			if (var.m_firstReadInEvent == -1) var.m_firstReadInEvent = cmdid;
+		} else {
+			var.m_lastWriteInEvent = cmdid;
+		}
+	}
+
+	// The candidate races of the event action race if they are not ordered. The variable
+	// state does not depend on the outcome, so all candidates are checked in one batch.
+	VarsInfo::AllRaces candidates;
+	for (size_t cmdid = 0; cmdid < op.m_commands.size(); ++cmdid) {
+		const ActionLog::Command& cmd = op.m_commands[cmdid];
+		if (cmd.m_cmdType != ActionLog::READ_MEMORY && cmd.m_cmdType != ActionLog::WRITE_MEMORY) continue;
+		VarState& var = m_vars[cmd.m_location];
+		if (var.m_skipped) continue;
+		int cmd_id = cmdid;
+		if (cmd.m_cmdType == ActionLog::READ_MEMORY) {
+			Access read(opid, cmd_id, var.m_lastWriteInEvent > cmd_id ? VarsInfo::MEMORY_UPDATE : VarsInfo::MEMORY_READ);
+			const Access& write = var.m_lastWrite;
+			if (write.m_eventActionId != -1 && inWindow(write.m_eventActionId, opid)) {
+				// A write-read race.
+				candidates.push_back(VarsInfo::RaceInfo(
+						write.m_type, read.m_type,
+						write.m_eventActionId, opid,
+						write.m_commandIdInEvent, cmd_id,
+						cmd.m_location));
+			}
+			// Retire the reads that fell out of the window.
+			while (var.m_firstRead < var.m_reads.size() &&
+					!inWindow(var.m_reads[var.m_firstRead].m_eventActionId, opid)) {
+				++var.m_firstRead;
+			}
+			if (var.m_firstRead > var.m_reads.size() / 2) {
+				var.m_reads.erase(var.m_reads.begin(), var.m_reads.begin() + var.m_firstRead);
+				var.m_firstRead = 0;
+			}
+			var.m_reads.push_back(read);
+		} else {
+			Access write(opid, cmd_id,
+					var.m_firstReadInEvent != -1 && var.m_firstReadInEvent < cmd_id ? VarsInfo::MEMORY_UPDATE : VarsInfo::MEMORY_WRITE);
+			const Access& last_write = var.m_lastWrite;
+			if (last_write.m_eventActionId != -1 && inWindow(last_write.m_eventActionId, opid)) {
+				// A write-write race.
+				candidates.push_back(VarsInfo::RaceInfo(
+						last_write.m_type, write.m_type,
+						last_write.m_eventActionId, opid,
+						last_write.m_commandIdInEvent, cmd_id,
+						cmd.m_location));
+			}
+			// Read-write races. VarsInfo finds them going backwards from the write.
+			for (size_t i = var.m_reads.size(); i > var.m_firstRead;) {
+				--i;
+				const Access& read = var.m_reads[i];
+				if (inWindow(read.m_eventActionId, opid)) {
+					candidates.push_back(VarsInfo::RaceInfo(
+							read.m_type, write.m_type,
+							read.m_eventActionId, opid,
+							read.m_commandIdInEvent, cmd_id,
+							cmd.m_location));
+				}
+			}
+			var.m_reads.clear();
+			var.m_firstRead = 0;
+			var.m_lastWrite = write;
+		}
+	}
+
+	std::vector<EventGraphInterface::OrderQuery> queries;
+	queries.reserve(candidates.size());
+	for (size_t i = 0; i < candidates.size(); ++i) {
+		queries.push_back(EventGraphInterface::OrderQuery(candidates[i].m_event1, opid));
+	}
+	std::vector<bool> ordered;
+	m_graph.areOrderedBatch(queries, &ordered);
+	for (size_t i = 0; i < candidates.size(); ++i) {
+		if (!ordered[i]) races->push_back(candidates[i]);
+	}
+}
@@ -0,0 +1,105 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef TRACERACEDETECTOR_H_
+#define TRACERACEDETECTOR_H_
+
+#include <vector>
+
+#include "VarsInfo.h"
+
+class ActionLog;
+class AnalysisProgress;
+class EventGraphInterface;
+
+// Finds races with a single pass over the trace in the order of the event actions,
+// without first collecting the accesses of every variable like VarsInfo does.
+//
+// Like the online VCRaceDetector, it keeps a small state for every variable: the last
+// write and the reads after it. Every access is checked against the last write and
+// every write against the reads before it. With the chain decomposition, every check
+// compares the epoch of the earlier event action with the vector clock of the later one.
+// The reads are not merged into one epoch as in FastTrack, because all races
+// are reported and not only the first race on a variable.
+//
+// The races are the same as the races that VarsInfo finds and they are produced in
+// the order of VarsInfo::races().
+//
+// If a window is given, only races between event actions at most window apart are
+// reported and the reads that fall out of the window are dropped from the state.
+class TraceRaceDetector {
+public:
+	// A window of 0 means no window.
+	explicit TraceRaceDetector(const EventGraphInterface& graph, int window = 0);
+
+	// Appends the races in actions to races. If progress is not NULL, the detection
+	// reports to it and returns false if it has to stop.
+	bool findRaces(const ActionLog& actions, VarsInfo::AllRaces* races, AnalysisProgress* progress);
+
+	// Appends the races with the second access in the given event action. The event
+	// actions must be added in increasing order.
+	void addEventAction(const ActionLog& actions, int event_action_id, VarsInfo::AllRaces* races);
+
+	// No races are reported for the accesses to a skipped variable.
+	void skipVar(int var_id) {
+		getVarState(var_id).m_skipped = true;
+	}
+
+private:
+	struct Access {
+		Access(int event_action, int command, VarsInfo::VarAccessType type)
+			: m_eventActionId(event_action), m_commandIdInEvent(command), m_type(type) {
+		}
+
+		int m_eventActionId;
+		int m_commandIdInEvent;
+		VarsInfo::VarAccessType m_type;
+	};
+
+	struct VarState {
+		VarState() : m_lastWrite(-1, -1, VarsInfo::MEMORY_WRITE), m_firstRead(0), m_eventActionId(-1),
+			m_firstReadInEvent(-1), m_lastWriteInEvent(-1), m_skipped(false) {
+		}
+
+		// The last write or an access with event action -1 if there was no write.
+		Access m_lastWrite;
+		// The reads after the last write are m_reads[m_firstRead..]. The reads before
+		// m_firstRead fell out of the window.
+		std::vector<Access> m_reads;
+		size_t m_firstRead;
+
+		// First read and last write command in the event action m_eventActionId.
+		// Used to find the access types.
+		int m_eventActionId;
+		int m_firstReadInEvent;
+		int m_lastWriteInEvent;
+
+		bool m_skipped;
+	};
+
+	VarState& getVarState(int var_id);
+
+	// Returns true if a race between the two event actions is in the window.
+	bool inWindow(int event_action1, int event_action2) const {
+		return m_window == 0 || event_action2 - event_action1 <= m_window;
+	}
+
+	const EventGraphInterface& m_graph;
+	int m_window;
+	std::vector<VarState> m_vars;
+};
+
+#endif /* TRACERACEDETECTOR_H_ */
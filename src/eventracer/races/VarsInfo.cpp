@@ -18,12 +18,19 @@
 
 #include "ActionLog.h"
 #include "BitClocks.h"
+#include "ConnectivityModel.h"
 #include "EventGraph.h"
+#include "RaceCoverageIndex.h"
+#include "RaceHierarchy.h"
+#include "ReachabilityCache.h"
 #include "ThreadMapping.h"
+#include "TraceRaceDetector.h"
+#include "WindowedBitClocks.h"
 
 #include "gflags/gflags.h"
 
 #include <algorithm>
+#include <deque>
 #include <set>
 #include <utility>
 #include <queue>
@@ -31,60 +38,110 @@
 
 DEFINE_string(graph_connectivity_algorithm, "CD",
 		"Graph connectivity algorithm. Can be one of CD - chain decomposition,"
-		"BVC - bit vector clocks, BFS - breadth first search.");
+		"BVC - bit vector clocks, BFS - breadth first search, AUTO - chosen from the graph statistics.");
+DEFINE_int64(auto_connectivity_max_memory_mb, 4096,
+		"The memory limit for the connectivity algorithm chosen by --graph_connectivity_algorithm=AUTO.");
+DEFINE_int32(bfs_query_cache_size, 256, "The number of recent sources whose connectivity searches are "
+		"kept by the BFS connectivity algorithm and while the event graph is built. 0 disables the cache.");
+DEFINE_bool(transitive_reduction, true, "Build the connectivity data from the event graph without the "
+		"arcs that are implied by other paths.");
 DEFINE_int64(race_detection_timeout_seconds, 0, "If the timeout is set to a "
 		"positive integer, race detection algorithms fail if computation takes"
 		" more than the specified number of seconds.");
+DEFINE_bool(single_pass_race_detection, false,
+		"Find the races with a single pass over the trace instead of going over the accesses of every variable.");
+DEFINE_int32(race_window, 0, "If positive, only races between event actions at most this many event "
+		"actions apart are found. The race detection then only keeps the state for the window.");
+DEFINE_double(race_sampling_fraction, 1.0, "If less than 1, only a random subset with this fraction of "
+		"the memory locations is checked for races.");
+DEFINE_int32(race_sampling_seed, 1, "The seed that chooses the memory locations for --race_sampling_fraction.");
 
 
 // Checks races for multi-coverage.
+//
+// The graph over the uncovered races has an arc from race rj to race ri if rj
+// comes before ri and the second event of rj is before the first event of ri.
+// The arcs are not stored, but computed on demand. A path between two nodes can
+// only pass through races that are nested between the two nodes in the event
+// order, so every search first selects these races with a range query.
+//
+// The searches query the event graph in their inner loops, so they are in
+// RaceGraphImpl, which is templated on the connectivity backend.
 class RaceGraph {
 public:
-	RaceGraph(const VarsInfo& vars,
-			  const EventGraphInterface& graph)
+	virtual ~RaceGraph() {}
+
+	// Checks the top races starting from the race first_race. Returns false if the
+	// progress stopped the check. If window_clocks are given, they must be the graph of
+	// the RaceGraph and they are advanced to the second event of every checked race.
+	virtual bool checkCoverage(VarsInfo::AllRaces* all_races, int first_race, AnalysisProgress* progress,
+			WindowedBitClocks* window_clocks) = 0;
+
+	// Returns if there is a path in the graph from node1 to the given command in node2,
+	// where we can also follow existing races.
+	// If the function return true, the path via the races is in race_path.
+	virtual bool hasPathViaRaces(int node1, int node2, int cmd_in_node2,
+			std::vector<int>* race_path) const = 0;
+
+	// Returns if the race race_id is covered by one of the given races.
+	virtual bool isCoveredByAny(int race_id, const std::vector<int>& races) const = 0;
+
+	// Creates the race graph for the type of the given event graph.
+	static RaceGraph* create(const VarsInfo& vars, const EventGraphInterface& graph);
+};
+
+namespace {
+
+template <class EventGraph>
+class RaceGraphImpl : public RaceGraph {
+public:
+	RaceGraphImpl(const VarsInfo& vars,
+			  const EventGraph& graph)
 	    : m_vars(vars), m_races(vars.races()), m_graph(graph) {
 		initTopRaces();
 	}
 
-	// Build a graph with edge between a pair of races (rj, ri) if the
-	// second event of rj is before the first event of ri.
-	void buildTopGraph() {
-		m_topGraph.assign(m_topRaces.size(), std::vector<int>());
-		for (size_t j = 0; j < m_topRaces.size(); ++j) {
-			const VarsInfo::RaceInfo& rj = getRace(j);
-			for (size_t i = j + 1; i < m_topRaces.size(); ++i) {
-				const VarsInfo::RaceInfo& ri = getRace(i);
-				if (m_graph.areOrdered(rj.m_event2, ri.m_event1)) {
-					m_topGraph[j].push_back(i);
-				}
-			}
-		}
-	}
-
-	void checkCoverage(VarsInfo::AllRaces* all_races) {
+	virtual bool checkCoverage(VarsInfo::AllRaces* all_races, int first_race, AnalysisProgress* progress,
+			WindowedBitClocks* window_clocks) {
 		int numMultiCovered = 0;
-		for (size_t j = 0; j < m_topRaces.size(); ++j) {
-			if (isMultiCovered(j, &(*all_races)[m_topRaces[j]].m_multiParentRaces)) {
+		size_t first = std::lower_bound(m_topRaces.begin(), m_topRaces.end(), first_race) - m_topRaces.begin();
+		progress->startStage("Race multi-coverage", m_topRaces.size() - first);
+		for (size_t j = first; j < m_topRaces.size(); ++j) {
+			if (!progress->check(j - first)) return false;
+			VarsInfo::RaceInfo& race = (*all_races)[m_topRaces[j]];
+			if (window_clocks != NULL) {
+				window_clocks->advanceTo(race.m_event2);
+			}
+			if (isMultiCovered(j, &race.m_multiParentRaces)) {
 				++numMultiCovered;
 			}
+			race.m_coverageChecked = true;
 		}
 		printf("%d are multi-covered\n", numMultiCovered);
+		return true;
 	}
 
-	// Returns if there is a path in the graph from node1 to the given command in node2,
-	// where we can also follow existing races.
-	// If the function return true, the path via the races is in race_path.
-	bool hasPathViaRaces(int node1, int node2, int cmd_in_node2,
+	virtual bool hasPathViaRaces(int node1, int node2, int cmd_in_node2,
 			std::vector<int>* race_path) const {
 		race_path->clear();
 		if (node1 > node2) return false;
-		if (m_graph.areOrdered(node1, node2)) return true;
+		if (m_graph.isOrdered(node1, node2)) return true;
 
-		// Breadth-first search over races.
-		std::vector<int> parent(m_topRaces.size(), -2);  // -2 means not visited.
+		// Only the races between node1 and node2 can be on the path.
+		std::vector<int> nested;
+		findNestedRaces(node1, node2, &nested);
+
+		// Breadth-first search over races, starting from the races after node1.
+		std::vector<EventGraphInterface::OrderQuery> queries(nested.size());
+		for (size_t i = 0; i < nested.size(); ++i) {
+			queries[i] = EventGraphInterface::OrderQuery(node1, m_topEvent1[nested[i]]);
+		}
+		std::vector<bool> ordered;
+		m_graph.areOrderedBatch(queries, &ordered);
+		std::vector<int> parent(nested.size(), -2);  // -2 means not visited.
 		std::queue<int> q;
-		for (size_t i = 0; i < m_topRaces.size(); ++i) {
-			if (m_graph.areOrdered(node1, getRace(i).m_event1)) {
+		for (size_t i = 0; i < nested.size(); ++i) {
+			if (ordered[i]) {
 				q.push(i);
 				parent[i] = -1;  // No parent, but visited.
 			}
@@ -92,44 +149,97 @@ public:
 		while (!q.empty()) {
 			int currId = q.front();
 			q.pop();
-			const VarsInfo::RaceInfo& curr = getRace(currId);
-			if (curr.m_event2 > node2) continue;
+			const VarsInfo::RaceInfo& curr = getRace(nested[currId]);
 			if (!curr.canSynchronizeInThisOrder()) continue;
 
 			if ((curr.m_event2 == node2 && curr.m_cmdInEvent2 < cmd_in_node2) ||
-				(curr.m_event2 < node2 && m_graph.areOrdered(curr.m_event2, node2))) {
+				(curr.m_event2 < node2 && m_graph.isOrdered(curr.m_event2, node2))) {
 				while (currId >= 0) {
-					race_path->push_back(m_topRaces[currId]);
+					race_path->push_back(m_topRaces[nested[currId]]);
 					currId = parent[currId];
 				}
 				std::reverse(race_path->begin(), race_path->end());
 				return true;
 			}
-			const std::vector<int>& next = m_topGraph[currId];
-			for (size_t i = 0; i < next.size(); ++i) {
-				if (parent[next[i]] == -2) {  // if not visited.
-					q.push(next[i]);
-					parent[next[i]] = currId;
+			for (size_t i = currId + 1; i < nested.size(); ++i) {
+				if (parent[i] != -2) continue;  // if visited.
+				int next_event1 = m_topEvent1[nested[i]];
+				if (next_event1 >= curr.m_event2 && m_graph.isOrdered(curr.m_event2, next_event1)) {
+					q.push(i);
+					parent[i] = currId;
 				}
 			}
 		}
 		return false;
 	}
 
+	virtual bool isCoveredByAny(int race_id, const std::vector<int>& races) const {
+		const VarsInfo::RaceInfo& race2 = m_races[race_id];
+		for (size_t j = 0; j < races.size(); ++j) {
+			const VarsInfo::RaceInfo& race1 = m_races[races[j]];
+			if (!race1.canSynchronizeInThisOrder()) continue;
+			// race1 being a synchronization could prevent race2.
+			if (m_graph.isOrdered(race1.m_event2, race2.m_event2) &&
+					m_graph.isOrdered(race2.m_event1, race1.m_event1)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
 private:
 	void initTopRaces() {
 		for (size_t i = 0; i < m_races.size(); ++i) {
 			if (m_races[i].m_coveredBy == -1) {
 				m_topRaces.push_back(i);
+				m_topEvent1.push_back(m_races[i].m_event1);
+				m_topEvent2.push_back(m_races[i].m_event2);
 			}
 		}
 		printf("Using %d uncovered races\n", static_cast<int>(m_topRaces.size()));
+		if (!m_topRaces.empty()) {
+			m_maxEvent1.assign(4 * m_topRaces.size(), 0);
+			buildMaxTree(1, 0, m_topRaces.size());
+		}
 	}
 
 	const VarsInfo::RaceInfo& getRace(int topId) const {
 		return m_races[m_topRaces[topId]];
 	}
 
+	void buildMaxTree(int tree_node, int from, int to) {
+		if (to - from == 1) {
+			m_maxEvent1[tree_node] = m_topEvent1[from];
+			return;
+		}
+		int mid = (from + to) / 2;
+		buildMaxTree(2 * tree_node, from, mid);
+		buildMaxTree(2 * tree_node + 1, mid, to);
+		m_maxEvent1[tree_node] = std::max(m_maxEvent1[2 * tree_node], m_maxEvent1[2 * tree_node + 1]);
+	}
+
+	void reportNestedRaces(int tree_node, int from, int to, int limit, int min_event1,
+			std::vector<int>* result) const {
+		if (from >= limit || m_maxEvent1[tree_node] < min_event1) return;
+		if (to - from == 1) {
+			result->push_back(from);
+			return;
+		}
+		int mid = (from + to) / 2;
+		reportNestedRaces(2 * tree_node, from, mid, limit, min_event1, result);
+		reportNestedRaces(2 * tree_node + 1, mid, to, limit, min_event1, result);
+	}
+
+	// Returns the (sorted) uncovered races with the first event not before node1
+	// and the second event not after node2.
+	void findNestedRaces(int node1, int node2, std::vector<int>* nested) const {
+		// The races are sorted by their second event.
+		int limit = std::upper_bound(m_topEvent2.begin(), m_topEvent2.end(), node2) - m_topEvent2.begin();
+		if (limit > 0) {
+			reportNestedRaces(1, 0, m_topRaces.size(), limit, node1, nested);
+		}
+	}
+
 	// A race R is multi-covered if there is a path from a race after the beginning of
 	// R to a race before the end of R in the race graph.
 	// If a race is multi-covered, covered_by is set to a list of races covering the race.
@@ -140,32 +250,118 @@ private:
 
 	const VarsInfo& m_vars;
 	const VarsInfo::AllRaces& m_races;
-	const EventGraphInterface& m_graph;
+	const EventGraph& m_graph;
 	std::vector<int> m_topRaces;
-	std::vector<std::vector<int> > m_topGraph;
+	// First and second event of every race in m_topRaces. Kept separately from
+	// the races to scan them faster.
+	std::vector<int> m_topEvent1;
+	std::vector<int> m_topEvent2;
+	// Segment tree with the maximum first event for a range of m_topRaces.
+	std::vector<int> m_maxEvent1;
 };
 
+}  // namespace
+
+RaceGraph* RaceGraph::create(const VarsInfo& vars, const EventGraphInterface& graph) {
+	if (const ThreadMapping* clocks = dynamic_cast<const ThreadMapping*>(&graph)) {
+		return new RaceGraphImpl<ThreadMapping>(vars, *clocks);
+	}
+	if (const BitClocks* clocks = dynamic_cast<const BitClocks*>(&graph)) {
+		return new RaceGraphImpl<BitClocks>(vars, *clocks);
+	}
+	if (const WindowedBitClocks* clocks = dynamic_cast<const WindowedBitClocks*>(&graph)) {
+		return new RaceGraphImpl<WindowedBitClocks>(vars, *clocks);
+	}
+	if (const SimpleDirectedGraph* g = dynamic_cast<const SimpleDirectedGraph*>(&graph)) {
+		return new RaceGraphImpl<SimpleDirectedGraph>(vars, *g);
+	}
+	return new RaceGraphImpl<EventGraphInterface>(vars, graph);
+}
+
 //////////////////////////////////////////////////////////////////////////
 // class VarsInfo
 //////////////////////////////////////////////////////////////////////////
 
 
-VarsInfo::VarsInfo() : m_startTime(0), m_timedOut(false), m_timeToFindRacesMs(0), m_numChains(0),
-	m_fastEventGraph(NULL), m_raceGraph(NULL) {
+VarsInfo::VarsInfo() : m_progress(&m_defaultProgress), m_startTime(0), m_timeBudgetStarted(false), m_timedOut(false), m_timeToFindRacesMs(0), m_initTime(0), m_numChains(0),
+	m_raceWindow(0), m_samplingFraction(1.0), m_samplingSeed(0),
+	m_numNodes(0), m_numArcs(0), m_numGraphNodes(0), m_oldArcsFingerprint(0), m_numEventActions(0),
+	m_keepAccesses(true),
+	m_threadMapping(NULL), m_fastEventGraph(NULL), m_ownedEventGraph(NULL), m_coverageIndex(NULL), m_raceGraph(NULL), m_raceHierarchy(NULL) {
 }
 
 VarsInfo::~VarsInfo() {
-	delete m_fastEventGraph;
+	// Stop the background computation first, it uses the other fields.
+	delete m_raceHierarchy;
+	delete m_ownedEventGraph;
+	delete m_coverageIndex;
 	delete m_raceGraph;
 }
 
+namespace {
+// A hash of the variable id, uniformly distributed for consecutive ids.
+unsigned int VarSampleHash(int var_id, unsigned int seed) {
+	unsigned int h = static_cast<unsigned int>(var_id) * 0x9e3779b1u ^ seed * 0x85ebca77u;
+	h ^= h >> 16;
+	h *= 0x7feb352du;
+	h ^= h >> 15;
+	h *= 0x846ca68bu;
+	h ^= h >> 16;
+	return h;
+}
+
+// An FNV-1a hash of the arcs to the first num_nodes nodes of the graph.
+unsigned long long ArcsFingerprint(const SimpleDirectedGraph& graph, int num_nodes) {
+	unsigned long long h = 14695981039346656037ULL;
+	for (int i = 0; i < num_nodes && i < graph.numNodes(); ++i) {
+		const std::vector<int>& predecessors = graph.nodePredecessors(i);
+		h = (h ^ static_cast<unsigned int>(predecessors.size())) * 1099511628211ULL;
+		for (size_t j = 0; j < predecessors.size(); ++j) {
+			h = (h ^ static_cast<unsigned int>(predecessors[j])) * 1099511628211ULL;
+		}
+	}
+	return h;
+}
+}  // namespace
+
 void VarsInfo::init(const ActionLog& actions) {
-	for (int opid = 0; opid <= actions.maxEventActionId(); ++opid) {
+	m_numEventActions = 0;
+	m_samplingFraction = std::min(FLAGS_race_sampling_fraction, 1.0);
+	m_samplingSeed = FLAGS_race_sampling_seed;
+	m_skippedVars.clear();
+	// The race detection in a window reads the accesses from the trace.
+	m_keepAccesses = FLAGS_race_window <= 0;
+	addEventActionAccesses(actions);
+	if (m_samplingFraction < 1.0) {
+		printf("Sampled %d of %d memory locations (seed %d).\n",
+				static_cast<int>(m_vars.size()), static_cast<int>(m_vars.size() + m_skippedVars.size()),
+				m_samplingSeed);
+	}
+}
+
+bool VarsInfo::sampleVar(int var_id) {
+	if (m_samplingFraction >= 1.0) return true;
+	// The choice only depends on the variable id, so extendRaces makes the same choice.
+	if (VarSampleHash(var_id, m_samplingSeed) < m_samplingFraction * 4294967296.0) return true;
+	m_skippedVars.insert(var_id);
+	return false;
+}
+
+void VarsInfo::addEventActionAccesses(const ActionLog& actions) {
+	for (int opid = m_numEventActions; opid <= actions.maxEventActionId(); ++opid) {
 		std::map<int, VarAccess> per_var_accesses;
 		const ActionLog::EventAction& op = actions.event_action(opid);
 		for (size_t cmdid = 0; cmdid < op.m_commands.size(); ++cmdid) {
 			const ActionLog::Command& cmd = op.m_commands[cmdid];
-			if (cmd.m_cmdType == ActionLog::WRITE_MEMORY) {
+			if ((cmd.m_cmdType == ActionLog::WRITE_MEMORY || cmd.m_cmdType == ActionLog::READ_MEMORY) &&
+					!sampleVar(cmd.m_location)) {
+				continue;
+			}
+			if (!m_keepAccesses) {
+				if (cmd.m_cmdType == ActionLog::WRITE_MEMORY || cmd.m_cmdType == ActionLog::READ_MEMORY) {
+					m_vars[cmd.m_location];
+				}
+			} else if (cmd.m_cmdType == ActionLog::WRITE_MEMORY) {
 				VarAccess a;
 				a.m_eventActionId = opid;
 				a.m_commandIdInEvent = cmdid;
@@ -180,6 +376,7 @@ void VarsInfo::init(const ActionLog& actions) {
 			}
 		}
 	}
+	m_numEventActions = actions.maxEventActionId() + 1;
 }
 
 int VarsInfo::calculateFastTrackNumVCs() {
@@ -210,10 +407,7 @@ int VarsInfo::calculateFastTrackNumVCs() {
 	return num_allocated_vc;
 }
 
-void VarsInfo::findRaces(const ActionLog& actions, const SimpleDirectedGraph& graph) {
-	m_races.clear();
-
-
+void VarsInfo::updateGraphStatistics(const SimpleDirectedGraph& graph) {
 	m_numNodes = 0;
 	m_numArcs = 0;
 	for (int i = 0; i < graph.numNodes(); ++i) {
@@ -222,36 +416,276 @@ void VarsInfo::findRaces(const ActionLog& actions, const SimpleDirectedGraph& gr
 			++m_numNodes;
 		}
 	}
+	m_numGraphNodes = graph.numNodes();
+	m_oldArcsFingerprint = ArcsFingerprint(graph, m_numGraphNodes);
+	if (m_threadMapping != NULL) {
+		m_numChains = m_threadMapping->num_threads();
+	}
+}
 
-	m_startTime = GetCurrentTimeMicros();
+void VarsInfo::findRaces(const ActionLog& actions, const SimpleDirectedGraph& graph) {
+	m_races.clear();
+
+	startComputation();
 	m_numChains = 0;
-	if (FLAGS_graph_connectivity_algorithm == "CD") {
+	m_threadMapping = NULL;
+	// No two nodes are farther apart than the number of nodes, and the clocks of the
+	// window take memory quadratic in its size.
+	m_raceWindow = std::min(std::max(FLAGS_race_window, 0), graph.numNodes());
+	std::string algorithm = FLAGS_graph_connectivity_algorithm;
+	ConnectivityModel* model = NULL;
+	if (algorithm == "AUTO" && m_raceWindow == 0) {
+		// Every access is checked against about one other access.
+		int64 num_queries = 0;
+		for (AllVarData::const_iterator it = m_vars.begin(); it != m_vars.end(); ++it) {
+			num_queries += it->second.m_accesses.size();
+		}
+		model = new ConnectivityModel(graph, num_queries);
+		model->printPredictions();
+		algorithm = model->choose(FLAGS_auto_connectivity_max_memory_mb << 20);
+		printf("Using the %s connectivity algorithm.\n", algorithm.c_str());
+	}
+	// The clocks and the searches give the same answers without the transitive arcs, but
+	// join or follow fewer arcs.
+	const SimpleDirectedGraph* clock_graph = &graph;
+	SimpleDirectedGraph reduced_graph;
+	if (FLAGS_transitive_reduction && m_raceWindow == 0) {
+		int64 reduction_start = GetCurrentTimeMicros();
+		reduced_graph = graph;
+		int num_removed = reduced_graph.removeTransitiveArcs(m_progress);
+		printf("Transitive reduction removed %d arcs (%lld ms).\n", num_removed,
+				(GetCurrentTimeMicros() - reduction_start) / 1000);
+		clock_graph = &reduced_graph;
+	}
+	if (m_raceWindow > 0) {
+		// The race detection computes the clocks only for the window. The other
+		// connectivity queries search the given graph, which is not copied.
+		m_fastEventGraph = &graph;
+	} else if (algorithm == "CD") {
 		// Use vector clocks with chain decomposition.
+		// The chains are found in the full graph, which gives longer chains.
 		ThreadMapping* tmp = new ThreadMapping();
-		tmp->build(graph);
+		tmp->build(graph, m_progress);
 
-		tmp->computeVectorClocks(graph);
-		m_fastEventGraph = tmp;
-
-		// Update statistics.
-		m_numChains = tmp->num_threads();
-	} else if (FLAGS_graph_connectivity_algorithm == "BFS") {
+		tmp->computeVectorClocks(*clock_graph, m_progress);
+		m_fastEventGraph = m_ownedEventGraph = tmp;
+		m_threadMapping = tmp;
+	} else if (algorithm == "BFS") {
 		// Use breadth-first search for connectivity algorithm.
 
 		SimpleDirectedGraph* tmp = new SimpleDirectedGraph();
-		*tmp = graph;
-		m_fastEventGraph = tmp;
-	} else if (FLAGS_graph_connectivity_algorithm == "BVC") {
+		*tmp = *clock_graph;
+		tmp->setQueryCacheSize(FLAGS_bfs_query_cache_size);
+		m_fastEventGraph = m_ownedEventGraph = tmp;
+	} else if (algorithm == "BVC") {
 		// Use bit vector clocks connectivity algorithm.
 
 		BitClocks* tmp = new BitClocks();
-		tmp->build(graph);
-		m_fastEventGraph = tmp;
+		tmp->build(*clock_graph, m_progress);
+		m_fastEventGraph = m_ownedEventGraph = tmp;
+	}
+	if (shouldStop(0)) {
+		// The clocks are not complete, answer the connectivity queries with the graph itself.
+		// The race detection below stops before finding any races.
+		delete m_ownedEventGraph;
+		SimpleDirectedGraph* tmp = new SimpleDirectedGraph();
+		*tmp = graph;
+		m_fastEventGraph = m_ownedEventGraph = tmp;
+		m_threadMapping = NULL;
 	}
 	// Record how much time we needed for the connectivity algorithm initialization.
 	m_initTime = (GetCurrentTimeMicros() - m_startTime) / 1000;
+	updateGraphStatistics(graph);
+
+	if (m_raceWindow > 0) {
+		findRacesInWindow(actions, graph);
+	} else {
+		if (FLAGS_single_pass_race_detection) {
+			findRacesInTrace(actions);
+		} else {
+			for (AllVarData::iterator it = m_vars.begin(); it != m_vars.end(); ++it) {
+				it->second.m_numCheckedAccesses = 0;
+				it->second.m_lastCheckedWrite = -1;
+			}
+			findNewRaces();
+		}
+		findRaceDependency(graph, 0);
+	}
+
+	m_timeToFindRacesMs = (GetCurrentTimeMicros() - m_startTime) / 1000;
+	const SimpleDirectedGraph* search_graph = dynamic_cast<const SimpleDirectedGraph*>(m_fastEventGraph);
+	if (search_graph != NULL && search_graph->queryCache() != NULL) {
+		const ReachabilityCache* cache = search_graph->queryCache();
+		printf("BFS query cache: %lld hits, %lld misses.\n", cache->numHits(), cache->numMisses());
+	}
+	if (model != NULL) {
+		int64 memory_bytes = 0;
+		const BitClocks* bit_clocks = dynamic_cast<const BitClocks*>(m_fastEventGraph);
+		if (m_threadMapping != NULL) {
+			memory_bytes = m_threadMapping->memoryBytes();
+		} else if (bit_clocks != NULL) {
+			memory_bytes = bit_clocks->memoryBytes();
+		} else if (search_graph != NULL) {
+			memory_bytes = search_graph->memoryBytes();
+		}
+		model->printActual(algorithm, m_initTime, m_timeToFindRacesMs, memory_bytes);
+		delete model;
+	}
+}
+
+void VarsInfo::extendRaces(const ActionLog& actions, const SimpleDirectedGraph& graph) {
+	// Check that the arcs to the already analyzed nodes did not change.
+	if (m_ownedEventGraph == NULL || m_timedOut || m_raceWindow > 0 ||
+			graph.numNodes() < m_numGraphNodes ||
+			ArcsFingerprint(graph, m_numGraphNodes) != m_oldArcsFingerprint) {
+		printf("Cannot extend the races, recomputing them...\n");
+		delete m_raceHierarchy;
+		m_raceHierarchy = NULL;
+		delete m_ownedEventGraph;
+		m_ownedEventGraph = NULL;
+		m_fastEventGraph = NULL;
+		m_vars.clear();
+		init(actions);
+		findRaces(actions, graph);
+		return;
+	}
+
+	// The background computation uses the races.
+	bool restart_race_hierarchy = m_raceHierarchy != NULL;
+	delete m_raceHierarchy;
+	m_raceHierarchy = NULL;
+
+	startComputation();
+	m_ownedEventGraph->extend(graph, m_numGraphNodes);
+	m_initTime += (GetCurrentTimeMicros() - m_startTime) / 1000;
+	updateGraphStatistics(graph);
+	addEventActionAccesses(actions);
+
+	// All new races are on the new event actions and they are sorted after the old races.
+	int first_new_race = m_races.size();
+	findNewRaces();
+	findRaceDependency(graph, first_new_race);
+	printf("Extended with %d new races.\n", static_cast<int>(m_races.size()) - first_new_race);
+
+	m_timeToFindRacesMs += (GetCurrentTimeMicros() - m_startTime) / 1000;
+	if (restart_race_hierarchy) {
+		startRaceHierarchyBuild();
+	}
+}
+
+void VarsInfo::findRacesInTrace(const ActionLog& actions) {
+	TraceRaceDetector detector(*m_fastEventGraph);
+	for (std::set<int>::const_iterator it = m_skippedVars.begin(); it != m_skippedVars.end(); ++it) {
+		detector.skipVar(*it);
+	}
+	if (!detector.findRaces(actions, &m_races, m_progress)) {
+		shouldStop(0);
+	}
+
+	// All accesses are checked, extendRaces continues after them.
+	for (AllVarData::iterator it = m_vars.begin(); it != m_vars.end(); ++it) {
+		VarData& data = it->second;
+		data.m_numCheckedAccesses = data.m_accesses.size();
+		data.m_lastCheckedWrite = -1;
+		for (int i = data.m_accesses.size(); i > 0;) {
+			--i;
+			if (!data.m_accesses[i].m_isRead) {
+				data.m_lastCheckedWrite = i;
+				break;
+			}
+		}
+	}
+	countVarRaces(actions);
+}
 
+void VarsInfo::countVarRaces(const ActionLog& actions) {
+	for (AllVarData::iterator it = m_vars.begin(); it != m_vars.end(); ++it) {
+		it->second.clearRaces();
+	}
+	for (size_t i = 0; i < m_races.size(); ++i) {
+		const RaceInfo& race = m_races[i];
+		VarData& data = m_vars[race.m_varId];
+		const ActionLog::Command& cmd1 = actions.event_action(race.m_event1).m_commands[race.m_cmdInEvent1];
+		const ActionLog::Command& cmd2 = actions.event_action(race.m_event2).m_commands[race.m_cmdInEvent2];
+		if (cmd1.m_cmdType == ActionLog::READ_MEMORY) {
+			++data.m_numRWRaces;
+		} else if (cmd2.m_cmdType == ActionLog::WRITE_MEMORY) {
+			++data.m_numWWRaces;
+		} else {
+			++data.m_numWRRaces;
+		}
+	}
 
+	int vars_ww = 0, vars_rw = 0, vars_wr = 0;
+	for (AllVarData::iterator it = m_vars.begin(); it != m_vars.end(); ++it) {
+		vars_ww += it->second.m_numWWRaces != 0;
+		vars_rw += it->second.m_numRWRaces != 0;
+		vars_wr += it->second.m_numWRRaces != 0;
+	}
+	printf("Has %d vars with WW races, %d with RW and %d with WR.\n", vars_ww, vars_rw, vars_wr);
+}
+
+namespace {
+bool RaceCommandLess(const VarsInfo::RaceInfo& a, const VarsInfo::RaceInfo& b) {
+	return a.m_cmdInEvent2 < b.m_cmdInEvent2;
+}
+
+}  // namespace
+
+void VarsInfo::findRacesInWindow(const ActionLog& actions, const SimpleDirectedGraph& graph) {
+	printf("Race window: %d event actions.\n", m_raceWindow);
+	WindowedBitClocks clocks(graph, m_raceWindow);
+	TraceRaceDetector detector(clocks, m_raceWindow);
+	for (std::set<int>::const_iterator it = m_skippedVars.begin(); it != m_skippedVars.end(); ++it) {
+		detector.skipVar(*it);
+	}
+	// The uncovered races that may cover the next races, in the order of their ids.
+	std::deque<int> top_races;
+	m_progress->startStage("Race detection in window", actions.maxEventActionId() + 1);
+	for (int opid = 0; opid <= actions.maxEventActionId(); ++opid) {
+		if (!m_progress->update(opid) && shouldStop(opid)) break;
+		clocks.advanceTo(opid);
+		size_t first_race = m_races.size();
+		detector.addEventAction(actions, opid, &m_races);
+		// Keep the races in the order of sortRaces.
+		std::stable_sort(m_races.begin() + first_race, m_races.end(), RaceCommandLess);
+
+		// A race with the second event before the window cannot cover a race in the window.
+		while (!top_races.empty() && m_races[top_races.front()].m_event2 < opid - m_raceWindow) {
+			top_races.pop_front();
+		}
+		// The races are found in the order of their ids, so the same coverage as
+		// in findRaceDependency is computed for every race when it is found.
+		for (size_t i = first_race; i < m_races.size(); ++i) {
+			RaceInfo& race2 = m_races[i];
+			for (size_t k = 0; k < top_races.size(); ++k) {
+				int j = top_races[k];
+				RaceInfo& race1 = m_races[j];
+				if (!race1.canSynchronizeInThisOrder() || race1.m_event1 < race2.m_event1) continue;
+				if (clocks.areOrdered(race1.m_event2, race2.m_event2) &&
+						clocks.areOrdered(race2.m_event1, race1.m_event1)) {
+					race2.m_coveredBy = j;
+					race1.m_childRaces.push_back(i);
+				}
+			}
+			if (race2.m_coveredBy == -1) {
+				top_races.push_back(i);
+			} else {
+				race2.m_coverageChecked = true;
+			}
+		}
+	}
+	countVarRaces(actions);
+
+	delete m_coverageIndex;
+	m_coverageIndex = new RaceCoverageIndex(m_races);
+	updateVarRaces(m_races.size());
+
+	printf("Searching for multi-race dependency...\n");
+	findMultiRaceDependency(graph, 0);
+}
+
+void VarsInfo::findNewRaces() {
 	int vars_ww = 0, vars_rw = 0, vars_wr = 0;
 
 	// Perform race detection. The algorithm is as follows:
@@ -261,9 +695,33 @@ void VarsInfo::findRaces(const ActionLog& actions, const SimpleDirectedGraph& gr
 	//     This should find the presence of write-write and write-read races.
 	//   - a second pass backwards finds all read-write races. Every read is checked
 	//     for connectivity with any following write.
-
-	for (AllVarData::iterator it = m_vars.begin(); it != m_vars.end(); ++it) {
+	// Only the accesses after the last checked write of a variable may participate
+	// in new races.
+
+	// The pairs of access indices that race if they are not ordered. All the candidate
+	// races of a variable are checked with one batch of connectivity queries.
+	std::vector<std::pair<int, int> > candidates;
+	std::vector<EventGraphInterface::OrderQuery> queries;
+	std::vector<bool> ordered;
+
+	m_progress->startStage("Race detection", m_vars.size());
+	int num_checked_vars = 0;
+	for (AllVarData::iterator it = m_vars.begin(); it != m_vars.end(); ++it, ++num_checked_vars) {
 		VarData& data = it->second;
+		if (data.m_numCheckedAccesses == static_cast<int>(data.m_accesses.size())) {
+			continue;
+		}
+		if (shouldStop(num_checked_vars)) break;
+		int first_new_access = data.m_numCheckedAccesses;
+		int last_checked_write = data.m_lastCheckedWrite;
+		int last_write_id = last_checked_write;
+		for (int i = first_new_access; i < static_cast<int>(data.m_accesses.size()); ++i) {
+			if (!data.m_accesses[i].m_isRead) {
+				last_write_id = i;
+			}
+		}
+		data.m_numCheckedAccesses = data.m_accesses.size();
+		data.m_lastCheckedWrite = last_write_id;
 
 		int num_writes = data.numWrites();
 		int num_reads = data.numReads();
@@ -271,97 +729,86 @@ void VarsInfo::findRaces(const ActionLog& actions, const SimpleDirectedGraph& gr
 			continue;
 		}
 
-		data.clearRaces();
+		if (first_new_access == 0) {
+			data.clearRaces();
+		}
 
-		int last_write_id = -1;
-		for (int i = 0; i < static_cast<int>(data.m_accesses.size()); ++i) {
-			const VarAccess& currAccess = data.m_accesses[i];
+		candidates.clear();
+		last_write_id = last_checked_write;
+		for (int i = first_new_access; i < static_cast<int>(data.m_accesses.size()); ++i) {
 			if (last_write_id != -1) {
-				const VarAccess& lastWrite = data.m_accesses[last_write_id];
-				if (!m_fastEventGraph->areOrdered(lastWrite.m_eventActionId, currAccess.m_eventActionId)) {
-					// A write-write or write-read race was detected.
-					m_races.push_back(RaceInfo(
-									data.getVarAccessTypeForId(last_write_id),
-									data.getVarAccessTypeForId(i),
-									lastWrite.m_eventActionId,
-									currAccess.m_eventActionId,
-									lastWrite.m_commandIdInEvent,
-									currAccess.m_commandIdInEvent,
-									it->first));
-					bool is_ww = !currAccess.m_isRead;
-					if (is_ww) {
-						++data.m_numWWRaces;
-					} else {
-						++data.m_numWRRaces;
-					}
-				}
+				// A write-write or write-read race if the accesses are not ordered.
+				candidates.push_back(std::make_pair(last_write_id, i));
 			}
-			if (!currAccess.m_isRead) {
+			if (!data.m_accesses[i].m_isRead) {
 				last_write_id = i;
 			}
 		}
+		int num_forward_candidates = candidates.size();
 
 		// Go in the reverse order of accesses to find read-write races.
 		last_write_id = -1;
-		for (int i = data.m_accesses.size(); i > 0;) {
+		for (int i = data.m_accesses.size(); i > last_checked_write + 1;) {
 			--i;
 			const VarAccess& currAccess = data.m_accesses[i];
-			if (last_write_id != -1) {
-				const VarAccess& lastWrite = data.m_accesses[last_write_id];
-				if (currAccess.m_isRead &&
-						!m_fastEventGraph->areOrdered(currAccess.m_eventActionId, lastWrite.m_eventActionId)) {
-					// A read-write race was detected.
-					m_races.push_back(RaceInfo(
-									data.getVarAccessTypeForId(i),
-									data.getVarAccessTypeForId(last_write_id),
-									currAccess.m_eventActionId,
-									lastWrite.m_eventActionId,
-									currAccess.m_commandIdInEvent,
-									lastWrite.m_commandIdInEvent,
-									it->first));
-					++data.m_numRWRaces;
-				}
+			if (last_write_id != -1 && currAccess.m_isRead) {
+				candidates.push_back(std::make_pair(i, last_write_id));
 			}
 			if (!currAccess.m_isRead) {
 				last_write_id = i;
 			}
 		}
 
+		queries.resize(candidates.size());
+		for (size_t k = 0; k < candidates.size(); ++k) {
+			queries[k].first = data.m_accesses[candidates[k].first].m_eventActionId;
+			queries[k].second = data.m_accesses[candidates[k].second].m_eventActionId;
+		}
+		m_fastEventGraph->areOrderedBatch(queries, &ordered);
+		for (size_t k = 0; k < candidates.size(); ++k) {
+			if (ordered[k]) continue;
+			int access1 = candidates[k].first;
+			int access2 = candidates[k].second;
+			m_races.push_back(RaceInfo(
+							data.getVarAccessTypeForId(access1),
+							data.getVarAccessTypeForId(access2),
+							data.m_accesses[access1].m_eventActionId,
+							data.m_accesses[access2].m_eventActionId,
+							data.m_accesses[access1].m_commandIdInEvent,
+							data.m_accesses[access2].m_commandIdInEvent,
+							it->first));
+			if (static_cast<int>(k) >= num_forward_candidates) {
+				++data.m_numRWRaces;
+			} else if (data.m_accesses[access2].m_isRead) {
+				++data.m_numWRRaces;
+			} else {
+				++data.m_numWWRaces;
+			}
+		}
+
 		vars_ww += data.m_numWWRaces != 0;
 		vars_rw += data.m_numRWRaces != 0;
 		vars_wr += data.m_numWRRaces != 0;
-
-		if (shouldTimeout()) break;
 	}
 
 	printf("Has %d vars with WW races, %d with RW and %d with WR.\n", vars_ww, vars_rw, vars_wr);
-	findRaceDependency(actions);
-
-	m_timeToFindRacesMs = (GetCurrentTimeMicros() - m_startTime) / 1000;
 }
 
-class Op2IsAfter {
-public:
-	bool operator() (const VarsInfo::RaceInfo& r1, const VarsInfo::RaceInfo& r2) const {
-		if (r1.m_event2 == r2.m_event2) return r1.m_cmdInEvent2 < r2.m_cmdInEvent2;
-		return r1.m_event2 < r2.m_event2;
-	}
-};
-
-typedef std::pair<VarsInfo::RaceInfo, int> RaceAndPos;
-
-class Op2IsAfterPair {
-public:
-	bool operator() (const RaceAndPos& r1, const RaceAndPos& r2) const {
-		if (r1.first.m_event2 == r2.first.m_event2) {
-			if (r1.first.m_cmdInEvent2 == r2.first.m_cmdInEvent2) return r1.second < r2.second;
-			return r1.first.m_cmdInEvent2 < r2.first.m_cmdInEvent2;
-		}
-		return r1.first.m_event2 < r2.first.m_event2;
+namespace {
+// Sort key of a race: its position in m_races is sorted by the second event and then
+// by the command in the second event. Ties keep the original order.
+struct RaceSortKey {
+	int m_event2;
+	int m_cmdInEvent2;
+	int m_pos;
+
+	bool operator<(const RaceSortKey& o) const {
+		if (m_event2 != o.m_event2) return m_event2 < o.m_event2;
+		if (m_cmdInEvent2 != o.m_cmdInEvent2) return m_cmdInEvent2 < o.m_cmdInEvent2;
+		return m_pos < o.m_pos;
 	}
 };
 
-namespace {
 void RemapVector(const std::vector<int>& remapping, std::vector<int>* data) {
 	for (size_t i = 0; i < data->size(); ++i) {
 		(*data)[i] = remapping[(*data)[i]];
@@ -370,35 +817,72 @@ void RemapVector(const std::vector<int>& remapping, std::vector<int>* data) {
 
 }  // namespace
 
-bool VarsInfo::shouldTimeout() {
+void VarsInfo::startTimeBudget() {
 	if (FLAGS_race_detection_timeout_seconds != 0) {
-		bool result = (GetCurrentTimeMicros() - m_startTime) > FLAGS_race_detection_timeout_seconds * 1000000;
-		if (result) {
-			m_timedOut = true;
+		m_progress->setDeadline(GetCurrentTimeMicros() + FLAGS_race_detection_timeout_seconds * 1000000);
+	} else {
+		m_progress->setDeadline(0);
+	}
+	m_timeBudgetStarted = true;
+}
+
+void VarsInfo::startComputation() {
+	m_startTime = GetCurrentTimeMicros();
+	m_timedOut = false;
+	if (!m_timeBudgetStarted) {
+		startTimeBudget();
+	}
+	m_timeBudgetStarted = false;
+}
+
+bool VarsInfo::shouldStop(int64 done_work) {
+	if (m_progress->check(done_work)) return false;
+	if (!m_timedOut) {
+		m_timedOut = true;
+		if (m_progress->status().m_cancelled) {
+			fprintf(stderr, "Computation cancelled.\n");
+		} else {
 			fprintf(stderr, "Computation timed out.\n");
 		}
-		return result;
 	}
-	return false;
+	return true;
 }
 
 void VarsInfo::sortRaces() {
 	if (m_races.empty()) return;
-	std::vector<RaceAndPos> races(m_races.size(), RaceAndPos(m_races[0], 0));
+	// Only sort small keys and then move the races with swaps to avoid copying them.
+	std::vector<RaceSortKey> keys(m_races.size());
 	for (size_t i = 0; i < m_races.size(); ++i) {
-		races[i].first = m_races[i];
-		races[i].second = i;
-	}
-	std::sort(races.begin(), races.end(), Op2IsAfterPair());
-	for (size_t i = 0; i < m_races.size(); ++i) {
-		m_races[i] = races[i].first;
+		keys[i].m_event2 = m_races[i].m_event2;
+		keys[i].m_cmdInEvent2 = m_races[i].m_cmdInEvent2;
+		keys[i].m_pos = i;
 	}
+	std::sort(keys.begin(), keys.end());
 
 	std::vector<int> race_id_remapping(m_races.size());
+	bool is_sorted = true;
 	for (size_t i = 0; i < m_races.size(); ++i) {
 		// Create remapping : old position of a race to new position.
-		race_id_remapping[races[i].second] = i;
+		race_id_remapping[keys[i].m_pos] = i;
+		is_sorted = is_sorted && keys[i].m_pos == static_cast<int>(i);
+	}
+	if (is_sorted) return;
+	std::vector<RaceSortKey>().swap(keys);
+
+	// Apply the permutation cycle by cycle.
+	std::vector<bool> done(m_races.size(), false);
+	for (size_t i = 0; i < m_races.size(); ++i) {
+		if (done[i]) continue;
+		// Move the race at position i to its new position until the cycle is closed.
+		int pos = race_id_remapping[i];
+		while (pos != static_cast<int>(i)) {
+			m_races[i].swap(m_races[pos]);
+			done[pos] = true;
+			pos = race_id_remapping[pos];
+		}
+		done[i] = true;
 	}
+
 	for (AllVarData::iterator var_it = m_vars.begin(); var_it != m_vars.end(); ++var_it) {
 		VarData& var = var_it->second;
 		RemapVector(race_id_remapping, &var.m_childRaces);
@@ -406,84 +890,129 @@ void VarsInfo::sortRaces() {
 	}
 }
 
-void VarsInfo::findRaceDependency(const ActionLog& actions) {
+void VarsInfo::findRaceDependency(const SimpleDirectedGraph& graph, int first_new_race) {
 	printf("Searching for race dependency...\n");
 	sortRaces();
 
-	for (size_t j = 0; j < m_races.size(); ++j) {
+	for (size_t j = first_new_race; j < m_races.size(); ++j) {
 		m_races[j].m_coveredBy = -1;
-		m_vars[m_races[j].m_varId].m_allRaces.push_back(j);
 	}
+	delete m_coverageIndex;
+	m_coverageIndex = new RaceCoverageIndex(m_races);
+	std::vector<int> covered_races;
+	int num_processed_races = m_races.size();
+	m_progress->startStage("Race coverage", m_races.size());
 	for (size_t j = 0; j < m_races.size(); ++j) {
 		if (m_races[j].m_coveredBy != -1) continue;
+		if (shouldStop(j)) {
+			num_processed_races = j;
+			break;
+		}
 		const RaceInfo& race1 = m_races[j];
-		m_vars[race1.m_varId].m_noParentRaces.push_back(j);
 		if (!race1.canSynchronizeInThisOrder()) continue;
 
-		for (size_t i = j + 1; i < m_races.size(); ++i) {
-			const RaceInfo& race2 = m_races[i];
-			// race1 being a synchronization could prevent race2.
-
-			if (m_fastEventGraph->areOrdered(race1.m_event2, race2.m_event2) &&
-					m_fastEventGraph->areOrdered(race2.m_event1, race1.m_event1)) {
-				m_vars[race1.m_varId].m_childRaces.push_back(i);
-				m_vars[race2.m_varId].m_parentRaces.push_back(j);
-				m_races[i].m_coveredBy = j;
-				m_races[j].m_childRaces.push_back(i);
-			}
+		// The old races only need to be checked against the new ones.
+		m_coverageIndex->findCoveredRaces(j, *m_fastEventGraph, &covered_races, first_new_race);
+		for (size_t k = 0; k < covered_races.size(); ++k) {
+			int i = covered_races[k];
+			m_races[i].m_coveredBy = j;
+			m_races[j].m_childRaces.push_back(i);
+		}
+	}
+	// The covered races are checked once all the races before them are processed.
+	// The races that are not covered also need the multi-coverage check.
+	for (int i = first_new_race; i < num_processed_races; ++i) {
+		if (m_races[i].m_coveredBy != -1) {
+			m_races[i].m_coverageChecked = true;
 		}
-		if (shouldTimeout()) return;
 	}
+	updateVarRaces(num_processed_races);
 
 	printf("Searching for multi-race dependency...\n");
-	findMultiRaceDependency(actions);
+	findMultiRaceDependency(graph, first_new_race);
+}
+
+void VarsInfo::updateVarRaces(int num_processed_races) {
+	for (AllVarData::iterator it = m_vars.begin(); it != m_vars.end(); ++it) {
+		VarData& var = it->second;
+		var.m_childRaces.clear();
+		var.m_parentRaces.clear();
+		var.m_noParentRaces.clear();
+		var.m_allRaces.clear();
+	}
+	for (size_t j = 0; j < m_races.size(); ++j) {
+		const RaceInfo& race1 = m_races[j];
+		VarData& var = m_vars[race1.m_varId];
+		var.m_allRaces.push_back(j);
+		if (race1.m_coveredBy != -1 || static_cast<int>(j) >= num_processed_races) continue;
+		if (race1.m_multiParentRaces.empty()) {
+			var.m_noParentRaces.push_back(j);
+		}
+		for (size_t k = 0; k < race1.m_childRaces.size(); ++k) {
+			int i = race1.m_childRaces[k];
+			var.m_childRaces.push_back(i);
+			m_vars[m_races[i].m_varId].m_parentRaces.push_back(j);
+		}
+	}
 }
 
 void VarsInfo::getDirectRaceChildren(int race_id, bool only_different_event_actions, std::set<int>* direct_child_races) const {
+	if (m_raceHierarchy != NULL &&
+			m_raceHierarchy->getDirectRaceChildren(race_id, only_different_event_actions, direct_child_races)) {
+		return;
+	}
+	std::vector<int> base_race_direct_children;
+	computeDirectRaceChildren(race_id, only_different_event_actions, &base_race_direct_children);
+	direct_child_races->insert(base_race_direct_children.begin(), base_race_direct_children.end());
+}
+
+void VarsInfo::computeDirectRaceChildren(int race_id, bool only_different_event_actions, std::vector<int>* direct_child_races) const {
 	const RaceInfo& base_race = m_races[race_id];
+	direct_child_races->clear();
 
-	std::vector<int> base_race_direct_children;
-	for (size_t i = race_id + 1; i < m_races.size(); ++i) {
-		const RaceInfo& race2 = m_races[i];
+	std::vector<int> child_races;
+	m_coverageIndex->findCoveredRaces(race_id, *m_fastEventGraph, &child_races, 0);
+	for (size_t k = 0; k < child_races.size(); ++k) {
+		const RaceInfo& race2 = m_races[child_races[k]];
 
 		if (only_different_event_actions && base_race.m_event1 == race2.m_event1 && base_race.m_event2 == race2.m_event2) {
 			continue;
 		}
 
-		// base_race being a synchronization could prevent race2.
-		if (m_fastEventGraph->areOrdered(base_race.m_event2, race2.m_event2) &&
-				m_fastEventGraph->areOrdered(race2.m_event1, base_race.m_event1)) {
-			// race2 is a child of base_race, but we do not know yet if it is a direct one.
-			// Check if race2 is not covered by another child of base_race.
-			bool covered_by_other_child = false;
-			for (size_t j = 0; j < base_race_direct_children.size(); ++j) {
-				const RaceInfo& race1 = m_races[base_race_direct_children[j]];
-				if (!race1.canSynchronizeInThisOrder()) continue;
-				// race1 being a synchronization could prevent race2.
-				if (m_fastEventGraph->areOrdered(race1.m_event2, race2.m_event2) &&
-						m_fastEventGraph->areOrdered(race2.m_event1, race1.m_event1)) {
-					covered_by_other_child = true;
-					break;
-				}
-			}
-			if (!covered_by_other_child) {
-				base_race_direct_children.push_back(i);
-				direct_child_races->insert(i);
-			}
+		// race2 is a child of base_race, but we do not know yet if it is a direct one.
+		// Check if race2 is not covered by another child of base_race.
+		if (!m_raceGraph->isCoveredByAny(child_races[k], *direct_child_races)) {
+			direct_child_races->push_back(child_races[k]);
 		}
 	}
 }
 
+void VarsInfo::startRaceHierarchyBuild() {
+	if (m_raceHierarchy != NULL) return;
+	m_raceHierarchy = new RaceHierarchy();
+	m_raceHierarchy->startBuild(this);
+}
+
 bool VarsInfo::hasPathViaRaces(int node1, int node2, int cmd_in_node2,
 		std::vector<int>* race_path) const {
 	return m_raceGraph->hasPathViaRaces(node1, node2, cmd_in_node2, race_path);
 }
 
-void VarsInfo::findMultiRaceDependency(const ActionLog& actions) {
+void VarsInfo::findMultiRaceDependency(const SimpleDirectedGraph& graph, int first_new_race) {
 	delete m_raceGraph;
-	m_raceGraph = new RaceGraph(*this, *m_fastEventGraph);
-	m_raceGraph->buildTopGraph();
-	m_raceGraph->checkCoverage(&m_races);
+	m_raceGraph = RaceGraph::create(*this, *m_fastEventGraph);
+	bool done;
+	if (m_raceWindow > 0) {
+		// The multi-covering races are between the events of the race, so the window suffices.
+		WindowedBitClocks clocks(graph, m_raceWindow);
+		RaceGraphImpl<WindowedBitClocks> window_race_graph(*this, clocks);
+		done = window_race_graph.checkCoverage(&m_races, first_new_race, m_progress, &clocks);
+	} else {
+		done = m_raceGraph->checkCoverage(&m_races, first_new_race, m_progress, NULL);
+	}
+	if (!done) {
+		shouldStop(0);
+	}
 
 	// For each var, remove multi-covered races from the list of uncovered races.
 	for (AllVarData::iterator it = m_vars.begin(); it != m_vars.end(); ++it) {
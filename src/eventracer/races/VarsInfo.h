@@ -17,8 +17,10 @@
 #ifndef VARSINFO_H_
 #define VARSINFO_H_
 
+#include "AnalysisProgress.h"
 #include "base.h"
 #include <stddef.h>
+#include <algorithm>
 #include <map>
 #include <set>
 #include <vector>
@@ -26,18 +28,37 @@
 class ActionLog;
 class SimpleDirectedGraph;
 class EventGraphInterface;
+class ThreadMapping;
 
+class RaceCoverageIndex;
 class RaceGraph;
+class RaceHierarchy;
 
 class VarsInfo {
 public:
 	VarsInfo();
 	~VarsInfo();
 
+	// If --race_sampling_fraction is set, only the accesses to a random subset of the
+	// variables are recorded. The other variables are skipped by the race detection.
+	// With --race_window, the accesses are not recorded at all.
 	void init(const ActionLog& actions);
 
+	// With --race_window, the connectivity queries after the race detection search the
+	// graph, so it must not change or be destroyed while the races are used.
 	void findRaces(const ActionLog& actions, const SimpleDirectedGraph& graph);
 
+	// Finds the races after new event actions were appended to the actions and the graph.
+	// The graph must only have new arcs to the new nodes. If this is not the case, or if
+	// the previous race detection timed out, all the races are computed again.
+	// The ids of the races found before do not change.
+	void extendRaces(const ActionLog& actions, const SimpleDirectedGraph& graph);
+
+	// Starts the --race_detection_timeout_seconds budget of the next findRaces or extendRaces
+	// call now, so that the work reported to progress() before it counts against the budget.
+	// Without it, the budget starts in findRaces and extendRaces.
+	void startTimeBudget();
+
 	// Calculates the number of variables, for which FastTrack would need to allocate vector clocks.
 	int calculateFastTrackNumVCs();
 
@@ -72,7 +93,8 @@ public:
 	};
 
 	struct VarData {
-		VarData() : m_numWWRaces(0), m_numWRRaces(0), m_numRWRaces(0) {
+		VarData() : m_numWWRaces(0), m_numWRRaces(0), m_numRWRaces(0),
+			m_numCheckedAccesses(0), m_lastCheckedWrite(-1) {
 		}
 
 		std::vector<VarAccess> m_accesses;
@@ -159,6 +181,11 @@ public:
 		std::vector<int> m_noParentRaces;
 		// List of all races for a variable.
 		std::vector<int> m_allRaces;
+
+		// The number of accesses already checked for races.
+		int m_numCheckedAccesses;
+		// The index of the last write among the checked accesses or -1.
+		int m_lastCheckedWrite;
 	};
 	typedef std::map<int, VarData> AllVarData;
 
@@ -189,7 +216,22 @@ public:
 			: m_access1(a1), m_access2(a2),
 			  m_event1(e1), m_event2(e2),
 			  m_cmdInEvent1(command_in_e1), m_cmdInEvent2(command_in_e2),
-			  m_varId(v), m_coveredBy(-1) {
+			  m_varId(v), m_coveredBy(-1), m_coverageChecked(false) {
+		}
+
+		// Exchanges the contents of two races without copying the race lists.
+		void swap(RaceInfo& o) {
+			std::swap(m_access1, o.m_access1);
+			std::swap(m_access2, o.m_access2);
+			std::swap(m_event1, o.m_event1);
+			std::swap(m_event2, o.m_event2);
+			std::swap(m_cmdInEvent1, o.m_cmdInEvent1);
+			std::swap(m_cmdInEvent2, o.m_cmdInEvent2);
+			std::swap(m_varId, o.m_varId);
+			std::swap(m_coveredBy, o.m_coveredBy);
+			m_childRaces.swap(o.m_childRaces);
+			m_multiParentRaces.swap(o.m_multiParentRaces);
+			std::swap(m_coverageChecked, o.m_coverageChecked);
 		}
 
 		bool canSynchronizeInThisOrder() const {
@@ -212,6 +254,10 @@ public:
 		// If a race is covered only by more than one other race, these
 		// show up here.
 		std::vector<int> m_multiParentRaces;
+
+		// Whether m_coveredBy and m_multiParentRaces are final. Only false for some races
+		// if the race detection timed out or was cancelled.
+		bool m_coverageChecked;
 	};
 
 	typedef std::vector<RaceInfo> AllRaces;
@@ -221,10 +267,30 @@ public:
 	// Appends the set of direct child races of a race to the given set.
 	void getDirectRaceChildren(int race_id, bool only_different_event_actions, std::set<int>* direct_child_races) const;
 
+	// Computes the sorted list of direct child races of a race without using the race hierarchy.
+	void computeDirectRaceChildren(int race_id, bool only_different_event_actions, std::vector<int>* direct_child_races) const;
+
+	// Starts computing the direct child races of all races in the background. Must be called
+	// after findRaces. Until the computation is done, getDirectRaceChildren computes them on demand.
+	void startRaceHierarchyBuild();
+
+	// Returns true if the last race detection timed out or was cancelled. In this case,
+	// only the races found before that are available and their coverage may not be checked.
 	bool timedOut() const {
 		return m_timedOut;
 	}
 
+	// Progress of the race detection. Can be used from other threads to query the
+	// status or to cancel the race detection.
+	AnalysisProgress* progress() {
+		return m_progress;
+	}
+
+	// Sets the progress used by the race detection. The progress must outlive this object.
+	void setProgress(AnalysisProgress* progress) {
+		m_progress = progress;
+	}
+
 	int timeToFindRacesMs() const {
 		return m_timeToFindRacesMs;
 	}
@@ -237,6 +303,21 @@ public:
 		return m_numChains;
 	}
 
+	// The maximum distance between the event actions of a race or 0 if there is no limit.
+	int raceWindow() const {
+		return m_raceWindow;
+	}
+
+	// The fraction of the variables checked for races, 1 if all of them are checked.
+	double samplingFraction() const {
+		return m_samplingFraction;
+	}
+
+	// The variables that are not in variables() because they were not sampled.
+	const std::set<int>& skippedVars() const {
+		return m_skippedVars;
+	}
+
 	int numNodes() const {
 		return m_numNodes;
 	}
@@ -253,29 +334,77 @@ public:
 			std::vector<int>* race_path) const;
 
 private:
-	// Returns true if a computation timed out and sets the m_timedOut variable to true.
-	bool shouldTimeout();
+	// Starts measuring the time of the computation and the time budget if it was not started.
+	void startComputation();
+
+	// Reports the done work of the current stage. Returns true if the computation timed out
+	// or was cancelled and sets the m_timedOut variable to true.
+	bool shouldStop(int64 done_work);
+
+	void addEventActionAccesses(const ActionLog& actions);
+	// Returns whether the accesses to a variable are recorded.
+	bool sampleVar(int var_id);
+	void updateGraphStatistics(const SimpleDirectedGraph& graph);
+
+	// Finds the races on the accesses that were not checked yet.
+	void findNewRaces();
+
+	// Finds all the races with TraceRaceDetector.
+	void findRacesInTrace(const ActionLog& actions);
+
+	// Finds the races and their coverage in a single pass with the clocks only for
+	// the race window.
+	void findRacesInWindow(const ActionLog& actions, const SimpleDirectedGraph& graph);
+
+	// Sets the number of races of every variable.
+	void countVarRaces(const ActionLog& actions);
 
 	void sortRaces();
 
-	void findRaceDependency(const ActionLog& actions);
+	// Only the races starting from first_new_race are new, the dependencies between
+	// the other races are already computed.
+	void findRaceDependency(const SimpleDirectedGraph& graph, int first_new_race);
+
+	// Fills the race lists of the variables from the coverage of the first
+	// num_processed_races races.
+	void updateVarRaces(int num_processed_races);
 
 	// Races must be sorted before calling this.
-	void findMultiRaceDependency(const ActionLog& actions);
+	void findMultiRaceDependency(const SimpleDirectedGraph& graph, int first_new_race);
 
+	AnalysisProgress m_defaultProgress;
+	AnalysisProgress* m_progress;
 	int64 m_startTime;
+	// Set by startTimeBudget until the next computation starts.
+	bool m_timeBudgetStarted;
 	bool m_timedOut;
 	int m_timeToFindRacesMs;
 	int m_initTime;
 	int m_numChains;
+	int m_raceWindow;
+	double m_samplingFraction;
+	int m_samplingSeed;
+	std::set<int> m_skippedVars;
 	int m_numNodes;
 	int m_numArcs;
+	int m_numGraphNodes;
+	// ArcsFingerprint of the arcs to the first m_numGraphNodes nodes.
+	unsigned long long m_oldArcsFingerprint;
+	int m_numEventActions;
+	// False with --race_window, then the variables have no m_accesses.
+	bool m_keepAccesses;
 
 	AllVarData m_vars;
 	AllRaces m_races;
 
-	EventGraphInterface* m_fastEventGraph;
+	// Set if m_fastEventGraph uses the chain decomposition.
+	const ThreadMapping* m_threadMapping;
+	// With a race window, the graph given to findRaces. Otherwise m_ownedEventGraph.
+	const EventGraphInterface* m_fastEventGraph;
+	EventGraphInterface* m_ownedEventGraph;
+	RaceCoverageIndex* m_coverageIndex;
 	RaceGraph* m_raceGraph;
+	RaceHierarchy* m_raceHierarchy;
 };
 
 #endif /* VARSINFO_H_ */
@@ -0,0 +1,260 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "ActionLog.h"
+#include "EventGraph.h"
+#include "VarsInfo.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "stringprintf.h"
+
+DECLARE_string(graph_connectivity_algorithm);
+DECLARE_bool(single_pass_race_detection);
+DECLARE_int32(race_window);
+
+// A random trace: the accesses of every event action and the arcs to it from earlier ones.
+struct RandomTrace {
+	std::vector<std::vector<std::pair<ActionLog::CommandType, int> > > m_accesses;
+	std::vector<std::vector<int> > m_predecessors;
+};
+
+RandomTrace makeRandomTrace(int num_event_actions, int num_vars, unsigned int seed) {
+	srand(seed);
+	RandomTrace trace;
+	trace.m_accesses.resize(num_event_actions);
+	trace.m_predecessors.resize(num_event_actions);
+	for (int i = 0; i < num_event_actions; ++i) {
+		int num_accesses = rand() % 5;
+		for (int j = 0; j < num_accesses; ++j) {
+			ActionLog::CommandType type = rand() % 3 == 0 ? ActionLog::WRITE_MEMORY : ActionLog::READ_MEMORY;
+			trace.m_accesses[i].push_back(std::make_pair(type, 1 + rand() % num_vars));
+		}
+		if (i == 0) continue;
+		int num_arcs = rand() % 3;
+		for (int j = 0; j < num_arcs; ++j) {
+			// Mostly arcs from recent event actions.
+			int distance = 1 + rand() % (rand() % 4 == 0 ? i : std::min(i, 8));
+			trace.m_predecessors[i].push_back(i - distance);
+		}
+	}
+	return trace;
+}
+
+// Appends the event actions of the trace up to end_event_action to the log and the graph.
+void appendEventActions(const RandomTrace& trace, int end_event_action,
+		ActionLog* log, SimpleDirectedGraph* graph) {
+	int first_event_action = graph->numNodes();
+	for (int i = first_event_action; i < end_event_action; ++i) {
+		log->startEventAction(i);
+		for (size_t j = 0; j < trace.m_accesses[i].size(); ++j) {
+			log->logCommand(trace.m_accesses[i][j].first, trace.m_accesses[i][j].second);
+		}
+		log->endEventAction();
+	}
+	graph->addNodesUpTo(end_event_action - 1);
+	for (int i = first_event_action; i < end_event_action; ++i) {
+		for (size_t j = 0; j < trace.m_predecessors[i].size(); ++j) {
+			graph->addArcIfNeeded(trace.m_predecessors[i][j], i);
+		}
+	}
+}
+
+void appendList(const char* name, const std::vector<int>& list, std::string* out) {
+	StringAppendF(out, " %s=[", name);
+	for (size_t i = 0; i < list.size(); ++i) {
+		StringAppendF(out, "%s%d", i == 0 ? "" : " ", list[i]);
+	}
+	out->append("]");
+}
+
+// Replaces an arc to one of the first num_nodes nodes with an arc from another node, so that
+// the number of arcs stays the same. Returns false if there is no such arc.
+bool moveOldArc(int num_nodes, SimpleDirectedGraph* graph) {
+	for (int target = num_nodes - 1; target > 0; --target) {
+		const std::vector<int>& predecessors = graph->nodePredecessors(target);
+		if (predecessors.empty()) continue;
+		int old_source = predecessors[0];
+		for (int source = 0; source < target; ++source) {
+			if (!graph->hasArc(source, target)) {
+				graph->deleteArc(old_source, target);
+				graph->addArc(source, target);
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+// Prints the races and the races of each variable. The number of accesses of each variable
+// is only printed with_accesses, since they are not kept with --race_window.
+std::string racesToString(const VarsInfo& vinfo, bool with_accesses) {
+	std::string out;
+	for (size_t i = 0; i < vinfo.races().size(); ++i) {
+		const VarsInfo::RaceInfo& race = vinfo.races()[i];
+		StringAppendF(&out, "#%d %s %d:%d-%d:%d v%d covered_by=%d", static_cast<int>(i),
+				race.TypeShortStr(), race.m_event1, race.m_cmdInEvent1,
+				race.m_event2, race.m_cmdInEvent2, race.m_varId, race.m_coveredBy);
+		appendList("child", race.m_childRaces, &out);
+		appendList("multi_parent", race.m_multiParentRaces, &out);
+		out.append("\n");
+	}
+	for (VarsInfo::AllVarData::const_iterator it = vinfo.variables().begin();
+			it != vinfo.variables().end(); ++it) {
+		const VarsInfo::VarData& var = it->second;
+		StringAppendF(&out, "v%d", it->first);
+		if (with_accesses) {
+			StringAppendF(&out, " accesses=%d", static_cast<int>(var.m_accesses.size()));
+		}
+		StringAppendF(&out, " ww=%d wr=%d rw=%d", var.m_numWWRaces, var.m_numWRRaces, var.m_numRWRaces);
+		appendList("child", var.m_childRaces, &out);
+		appendList("parent", var.m_parentRaces, &out);
+		appendList("no_parent", var.m_noParentRaces, &out);
+		appendList("all", var.m_allRaces, &out);
+		out.append("\n");
+	}
+	return out;
+}
+
+// Checks that finding the races for a prefix of the trace and extending them to the rest
+// gives the same races as finding them for the whole trace. With move_old_arc, an arc to
+// the prefix changes before the rest is appended.
+void expectExtendMatchesFull(const RandomTrace& trace, int prefix_percent, bool move_old_arc) {
+	int num_event_actions = trace.m_accesses.size();
+	int prefix_size = num_event_actions * prefix_percent / 100;
+
+	ActionLog full_log;
+	SimpleDirectedGraph full_graph;
+	appendEventActions(trace, prefix_size, &full_log, &full_graph);
+	if (move_old_arc) moveOldArc(prefix_size, &full_graph);
+	appendEventActions(trace, num_event_actions, &full_log, &full_graph);
+	VarsInfo full;
+	full.init(full_log);
+	full.findRaces(full_log, full_graph);
+
+	ActionLog log;
+	SimpleDirectedGraph graph;
+	appendEventActions(trace, prefix_size, &log, &graph);
+	VarsInfo extended;
+	extended.init(log);
+	extended.findRaces(log, graph);
+	if (move_old_arc) moveOldArc(prefix_size, &graph);
+	appendEventActions(trace, num_event_actions, &log, &graph);
+	extended.extendRaces(log, graph);
+
+	std::string expected = racesToString(full, true);
+	std::string actual = racesToString(extended, true);
+	if (expected != actual) {
+		fprintf(stderr, "Test failed with algorithm %s, a %d%% prefix and move_old_arc=%d! Expected races:\n%s"
+				"Actual races:\n%s^^^ FAIL ^^^\n", FLAGS_graph_connectivity_algorithm.c_str(),
+				prefix_percent, move_old_arc, expected.c_str(), actual.c_str());
+		throw 0;
+	}
+}
+
+// Finds the races in the whole trace with the current flags.
+std::string findRacesToString(const RandomTrace& trace, bool with_accesses) {
+	ActionLog log;
+	SimpleDirectedGraph graph;
+	appendEventActions(trace, trace.m_accesses.size(), &log, &graph);
+	VarsInfo vinfo;
+	vinfo.init(log);
+	vinfo.findRaces(log, graph);
+	return racesToString(vinfo, with_accesses);
+}
+
+void expectSameRaces(const std::string& expected, const std::string& actual, const char* description,
+		unsigned int seed) {
+	if (expected != actual) {
+		fprintf(stderr, "Test failed for %s on seed %u! Expected races:\n%sActual races:\n%s^^^ FAIL ^^^\n",
+				description, seed, expected.c_str(), actual.c_str());
+		throw 0;
+	}
+}
+
+void testExtendRacesMatchesFindRaces() {
+	printf("Starting test testExtendRacesMatchesFindRaces...\n");
+	const char* algorithms[] = { "CD", "BVC", "BFS" };
+	const int prefix_percents[] = { 30, 70 };
+	for (unsigned int seed = 1; seed <= 4; ++seed) {
+		RandomTrace trace = makeRandomTrace(150, 6, seed);
+		for (int i = 0; i < 3; ++i) {
+			FLAGS_graph_connectivity_algorithm = algorithms[i];
+			for (int j = 0; j < 2; ++j) {
+				expectExtendMatchesFull(trace, prefix_percents[j], false);
+			}
+		}
+	}
+	printf("Success\n");
+}
+
+void testExtendRacesAfterOldArcsChange() {
+	printf("Starting test testExtendRacesAfterOldArcsChange...\n");
+	const char* algorithms[] = { "CD", "BVC", "BFS" };
+	for (unsigned int seed = 1; seed <= 4; ++seed) {
+		RandomTrace trace = makeRandomTrace(150, 6, seed);
+		for (int i = 0; i < 3; ++i) {
+			FLAGS_graph_connectivity_algorithm = algorithms[i];
+			expectExtendMatchesFull(trace, 50, true);
+		}
+	}
+	printf("Success\n");
+}
+
+void testSinglePassMatchesDefault() {
+	printf("Starting test testSinglePassMatchesDefault...\n");
+	const char* algorithms[] = { "CD", "BVC", "BFS" };
+	for (unsigned int seed = 1; seed <= 4; ++seed) {
+		RandomTrace trace = makeRandomTrace(150, 6, seed);
+		for (int i = 0; i < 3; ++i) {
+			FLAGS_graph_connectivity_algorithm = algorithms[i];
+			std::string expected = findRacesToString(trace, true);
+			FLAGS_single_pass_race_detection = true;
+			std::string actual = findRacesToString(trace, true);
+			FLAGS_single_pass_race_detection = false;
+			expectSameRaces(expected, actual, algorithms[i], seed);
+		}
+	}
+	printf("Success\n");
+}
+
+void testWholeRaceWindowMatchesBitClocks() {
+	printf("Starting test testWholeRaceWindowMatchesBitClocks...\n");
+	FLAGS_graph_connectivity_algorithm = "BVC";
+	for (unsigned int seed = 1; seed <= 4; ++seed) {
+		RandomTrace trace = makeRandomTrace(150, 6, seed);
+		std::string expected = findRacesToString(trace, false);
+		// A window as large as the graph drops no races.
+		FLAGS_race_window = trace.m_accesses.size();
+		std::string actual = findRacesToString(trace, false);
+		FLAGS_race_window = 0;
+		expectSameRaces(expected, actual, "--race_window", seed);
+	}
+	printf("Success\n");
+}
+
+int main(void) {
+	testExtendRacesMatchesFindRaces();
+	testExtendRacesAfterOldArcsChange();
+	testSinglePassMatchesDefault();
+	testWholeRaceWindowMatchesBitClocks();
+	return 0;
+}
@@ -0,0 +1,61 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "WindowedBitClocks.h"
+
+#include <string.h>
+
+WindowedBitClocks::WindowedBitClocks(const SimpleDirectedGraph& graph, int window)
+	: m_graph(&graph), m_window(window), m_numWords((window + 1 + 31) / 32), m_lastNode(-1) {
+	m_clocks.assign(static_cast<size_t>(window + 1) * m_numWords, 0);
+}
+
+void WindowedBitClocks::advanceTo(int node_id) {
+	if (node_id >= m_graph->numNodes()) node_id = m_graph->numNodes() - 1;
+	while (m_lastNode < node_id) {
+		++m_lastNode;
+		unsigned int* cl = clock(m_lastNode);
+		memset(cl, 0, m_numWords * sizeof(unsigned int));
+		cl[0] = 1;  // The node itself.
+
+		const std::vector<int>& pred = m_graph->nodePredecessors(m_lastNode);
+		for (size_t j = 0; j < pred.size(); ++j) {
+			int shift = m_lastNode - pred[j];
+			if (shift <= 0 || shift > m_window) continue;
+			// Bit k of the predecessor clock becomes bit k + shift of this clock.
+			const unsigned int* pred_cl = clock(pred[j]);
+			int word_shift = shift / 32;
+			int bit_shift = shift % 32;
+			for (int i = m_numWords - 1; i >= word_shift; --i) {
+				unsigned int value = pred_cl[i - word_shift] << bit_shift;
+				if (bit_shift != 0 && i - word_shift - 1 >= 0) {
+					value |= pred_cl[i - word_shift - 1] >> (32 - bit_shift);
+				}
+				cl[i] |= value;
+			}
+		}
+		// Drop the bits beyond the window.
+		int num_bits = m_window + 1;
+		if (num_bits % 32 != 0) {
+			cl[m_numWords - 1] &= (1u << (num_bits % 32)) - 1;
+		}
+	}
+}
+
+void WindowedBitClocks::extend(const SimpleDirectedGraph& graph, int first_new_node) {
+	m_graph = &graph;
+	advanceTo(graph.numNodes() - 1);
+}
@@ -0,0 +1,78 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef WINDOWEDBITCLOCKS_H_
+#define WINDOWEDBITCLOCKS_H_
+
+#include <vector>
+#include "EventGraph.h"
+
+// Bit vector clocks restricted to a sliding window over the node ids.
+//
+// The clock of a node has one bit for each of the window preceding nodes: bit k is set
+// if node - k is before the node. The clocks are computed in the order of the node ids
+// and only the clocks of the last window + 1 nodes are kept, so the memory is
+// proportional to window^2 bits regardless of the size of the graph.
+//
+// A path between two nodes at most window apart only passes through nodes between them,
+// so the answers for such nodes are exact. The nodes further apart are never reported
+// as ordered.
+class WindowedBitClocks : public EventGraphInterface {
+public:
+	WindowedBitClocks(const SimpleDirectedGraph& graph, int window);
+
+	// Computes the clocks up to the given node. The nodes more than window before it
+	// are dropped. The nodes must be advanced in increasing order.
+	void advanceTo(int node_id);
+
+	// Only answers for nodes that are kept, i.e. at most window before the last
+	// advanced node.
+	virtual bool areOrdered(int slice1, int slice2) const {
+		return isOrdered(slice1, slice2);
+	}
+	// Same as areOrdered, but inlined into the loops that are templated on the backend.
+	bool isOrdered(int slice1, int slice2) const {
+		if (slice1 == slice2) return true;
+		int distance = slice2 - slice1;
+		if (distance < 0 || distance > m_window || slice2 > m_lastNode || slice2 < m_lastNode - m_window) {
+			return false;
+		}
+		return (clock(slice2)[distance / 32] >> (distance % 32)) & 1;
+	}
+
+	// Advances over the new nodes of the graph.
+	virtual void extend(const SimpleDirectedGraph& graph, int first_new_node);
+
+	int window() const { return m_window; }
+
+private:
+	unsigned int* clock(int node_id) {
+		return &m_clocks[(node_id % (m_window + 1)) * m_numWords];
+	}
+	const unsigned int* clock(int node_id) const {
+		return &m_clocks[(node_id % (m_window + 1)) * m_numWords];
+	}
+
+	const SimpleDirectedGraph* m_graph;
+	int m_window;
+	int m_numWords;
+	// The last node with a computed clock.
+	int m_lastNode;
+	// The clocks of the last window + 1 nodes, one after another.
+	std::vector<unsigned int> m_clocks;
+};
+
+#endif /* WINDOWEDBITCLOCKS_H_ */
@@ -18,6 +18,7 @@
 
 #include <algorithm>
 #include <map>
+#include <math.h>
 #include <set>
 #include <vector>
 #include <utility>
@@ -30,27 +31,50 @@
 #include "ActionLog.h"
 #include "RaceTags.h"
 #include "GraphFix.h"
+#include "LocationClasses.h"
 #include "TimerGraph.h"
 
+#include "gflags/gflags.h"
+
+DECLARE_int32(bfs_query_cache_size);
+
 using std::string;
 
 namespace {
-void dropNoFollowerEmptyEvents(
-		const ActionLog& log,
-		SimpleDirectedGraph* event_graph,
-		EventGraphInfo* graph_info) {
-	int num_dropped_events = 0;
-	for (int i = event_graph->numNodes(); i > 0;) {
-		--i;
-		if (event_graph->nodeSuccessors(i).size() == 0 &&
-				log.event_action(i).m_commands.size() == 0) {
-			event_graph->deleteNode(i);
-			graph_info->dropNode(i);
-			++num_dropped_events;
+// Estimates the sum of a value over all the variables from its values on a simple random
+// sample of the variables. The 95% confidence interval uses the normal approximation with
+// the finite population correction.
+class SampleTotal {
+public:
+	SampleTotal() : m_sum(0), m_sumSquares(0) {
+	}
+
+	void add(int value) {
+		m_sum += value;
+		m_sumSquares += static_cast<double>(value) * value;
+	}
+
+	void print(const std::string& filename, const char* name, int num_sampled, int num_total) const {
+		double estimate = m_sum;
+		double deviation = 0;
+		if (num_sampled > 0) {
+			double mean = m_sum / num_sampled;
+			estimate = mean * num_total;
+			if (num_sampled > 1) {
+				double variance = (m_sumSquares - num_sampled * mean * mean) / (num_sampled - 1);
+				double correction = 1.0 - static_cast<double>(num_sampled) / num_total;
+				deviation = 1.96 * num_total * sqrt(std::max(variance, 0.0) / num_sampled * correction);
+			}
 		}
+		// The races in the sample are a lower bound.
+		printf("%25s ,%20s,%7.0f,%9.1f,%9.1f,%9.1f\n", filename.c_str(), name, m_sum, estimate,
+				std::max(estimate - deviation, m_sum), estimate + deviation);
 	}
-	printf("Dropped %d events.\n", num_dropped_events);
-}
+
+private:
+	double m_sum;
+	double m_sumSquares;
+};
 }  // namespace
 
 RaceFile::RaceFile()
@@ -84,8 +108,12 @@ bool RaceFile::Load(const std::string& filename, bool eval_race_detector_time) {
 
 	fclose(f);
 	printf("DONE\n");
+	m_tags.Init();
 
 	m_inputEventGraph.addNodesUpTo(m_actions.maxEventActionId());
+	// The graph is built and fixed with arcs that are added only if the graph does not
+	// order their ends yet. The cache keeps these searches while the graph grows.
+	m_inputEventGraph.setQueryCacheSize(FLAGS_bfs_query_cache_size);
 	int num_arcs = 0, num_arcs_needed = 0;
 	for (size_t i = 0; i < m_actions.arcs().size(); ++i) {
 		const ActionLog::Arc& arc = m_actions.arcs()[i];
@@ -107,13 +135,20 @@ bool RaceFile::Load(const std::string& filename, bool eval_race_detector_time) {
 	fixer.makeIndependentEventExploration();
 	fixer.addScriptsAndResourcesHappensBefore();
 	fixer.addEventAfterTargetHappensBefore();
+	m_vars.materializeDerivedStrings();
+	// The cache only pays off while the graph grows.
+	m_inputEventGraph.setQueryCacheSize(0);
 	m_vinfo.init(m_actions);
 
 	printf("Variables loaded.\n");
 	printf("Building timers graph...\n");
+	// The timers graph is built within the time budget of the race detection.
+	m_vinfo.startTimeBudget();
 	m_graphWithTimers = m_inputEventGraph;
+	m_graphWithTimers.setQueryCacheSize(FLAGS_bfs_query_cache_size);
 	TimerGraph timer_graph(m_actions.arcs(), m_graphWithTimers);
-	timer_graph.build(&m_graphWithTimers);
+	timer_graph.build(&m_graphWithTimers, m_vinfo.progress());
+	m_graphWithTimers.setQueryCacheSize(0);
 	printf("Timers graph done.\n");
 
 	printf("Checking for races...\n");
@@ -259,6 +294,53 @@ void RaceFile::printVarStatsHeader() {
 		"Filename");
 }
 
+int RaceFile::numUncoveredRaces(const VarsInfo::VarData& var) const {
+	int result = 0;
+	for (size_t i = 0; i < var.m_noParentRaces.size(); ++i) {
+		if (m_vinfo.races()[var.m_noParentRaces[i]].m_multiParentRaces.empty()) ++result;
+	}
+	return result;
+}
+
+void RaceFile::printSampledRaceStats() {
+	if (m_vinfo.samplingFraction() >= 1.0) return;
+	SampleTotal all_races;
+	SampleTotal untagged_races;
+	SampleTotal tag_races[RaceTags::NUM_RACE_TAGS];
+	const VarsInfo::AllVarData& all_vars = m_vinfo.variables();
+	for (VarsInfo::AllVarData::const_iterator it = all_vars.begin(); it != all_vars.end(); ++it) {
+		int num_races = numUncoveredRaces(it->second);
+		RaceTags::RaceTagSet tags = RaceTags::emptyTagSet();
+		if (num_races > 0) {
+			tags = m_tags.getVariableTags(it->first);
+		}
+		all_races.add(num_races);
+		untagged_races.add(tags == RaceTags::emptyTagSet() ? num_races : 0);
+		for (int t = 0; t < static_cast<int>(RaceTags::NUM_RACE_TAGS); ++t) {
+			tag_races[t].add(RaceTags::hasTag(tags, static_cast<RaceTags::RaceTag>(t)) ? num_races : 0);
+		}
+	}
+
+	int num_sampled = all_vars.size();
+	int num_total = num_sampled + m_vinfo.skippedVars().size();
+	all_races.print(m_filename, "ALL", num_sampled, num_total);
+	for (int t = 0; t < static_cast<int>(RaceTags::NUM_RACE_TAGS); ++t) {
+		tag_races[t].print(m_filename, RaceTags::tagName(static_cast<RaceTags::RaceTag>(t)), num_sampled, num_total);
+	}
+	untagged_races.print(m_filename, "UNTAGGED", num_sampled, num_total);
+}
+
+void RaceFile::printSampledRaceStatsHeader() {
+	printf("%25s ,%20s,%7s,%9s,%9s,%9s\n", "Filename", "Class", "Sampled", "Estimate", "Low95", "High95");
+}
+
+void RaceFile::printSkippedVars() {
+	const std::set<int>& skipped = m_vinfo.skippedVars();
+	for (std::set<int>::const_iterator it = skipped.begin(); it != skipped.end(); ++it) {
+		printf("%25s : %s\n", m_filename.c_str(), m_vars.getString(*it));
+	}
+}
+
 void RaceFile::printTimeStats() {
 	printf("%25s,%8s,%8d,%8d,%5d,%8d,%8d,%8d,%7d,%9lld\n",
 			m_filename.c_str(),
@@ -351,6 +433,7 @@ int RaceFile::numRaces() const {
 }
 
 void RaceFile::evaluateAccordionClocks() {
+	LocationClasses var_classes(m_vars);
 	std::map<int, int> loc_to_op_id;
 	std::vector<int> cmds_in_op_id(m_actions.maxEventActionId() + 1, 0);
 	for (int op_id = 0; op_id < m_actions.maxEventActionId(); ++op_id) {
@@ -359,10 +442,7 @@ void RaceFile::evaluateAccordionClocks() {
 			const ActionLog::Command& cmd = op.m_commands[cmd_id];
 			if (cmd.m_cmdType == ActionLog::READ_MEMORY ||
 				cmd.m_cmdType == ActionLog::WRITE_MEMORY) {
-				const char* var_name = m_vars.getString(cmd.m_location);
-				if (strncmp(var_name, "Window", 6) == 0 ||
-					strncmp(var_name, "Tree", 4) == 0 ||
-					strncmp(var_name, "NodeTree", 8) == 0) {
+				if (var_classes.is(cmd.m_location, LocationClasses::USER_VISIBLE)) {
 					std::map<int, int>::const_iterator it = loc_to_op_id.find(cmd.m_location);
 					if (it != loc_to_op_id.end()) {
 						cmds_in_op_id[it->second]--;
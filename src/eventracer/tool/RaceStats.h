@@ -43,6 +43,13 @@ public:
 
 	void printHighRiskRaces();
 
+	// With --race_sampling_fraction, estimates the number of uncovered races of every
+	// race tag from the sampled variables and lists the variables that were skipped.
+	bool isSampled() const { return m_vinfo.samplingFraction() < 1.0; }
+	void printSampledRaceStatsHeader();
+	void printSampledRaceStats();
+	void printSkippedVars();
+
 	int numRaces() const;
 
 	void setFileId(const std::string& file_id) { m_fileId = file_id; }
@@ -52,6 +59,8 @@ public:
 
 private:
 	const char* getOpName(int var_id, int op_id) const;
+	// The number of races of the variable that are not covered or multi-covered.
+	int numUncoveredRaces(const VarsInfo::VarData& var) const;
 
 	std::string m_filename;
 	ActionLog m_actions;
@@ -17,12 +17,14 @@
 #include "RaceStats.h"
 
 #include <dirent.h>
+#include "gflags/gflags.h"
 #include <stdio.h>
 #include <vector>
 #include <string>
 
 
 int main(int argc, char* argv[]) {
+	google::ParseCommandLineFlags(&argc, &argv, true);
 	std::string path("/home/veselin/wk/eval/tiny_set_ae");
 	if (argc == 2) {
 		path = argv[1];
@@ -75,6 +77,19 @@ int main(int argc, char* argv[]) {
 		files[file_i]->printHighRiskRaces();
 	}
 
+	if (!files.empty() && files[0]->isSampled()) {
+		printf("\nSampled race estimates\n");
+		files[0]->printSampledRaceStatsHeader();
+		for (size_t file_i = 0; file_i < files.size(); ++file_i) {
+			files[file_i]->printSampledRaceStats();
+		}
+
+		printf("\nSkipped variables\n");
+		for (size_t file_i = 0; file_i < files.size(); ++file_i) {
+			files[file_i]->printSkippedVars();
+		}
+	}
+
 	for (size_t i = 0; i < files.size(); ++i) {
 		delete files[i];
 	}
@@ -47,19 +47,27 @@ void CallTraceBuilder::Init(
 	}
 
 	m_nodeTriggerPredecessors.assign(log.maxEventActionId() + 1, std::pair<int, int>(-1, -1));
-	m_parentScope.assign(log.maxEventActionId() + 1, std::vector<int>());
+	m_scopes.clear();
+	m_eventScopes.assign(log.maxEventActionId() + 2, 0);
 	std::vector<int> scope;
 	for (int op_id = 0; op_id <= log.maxEventActionId(); ++op_id) {
 		const ActionLog::EventAction& op = log.event_action(op_id);
 		scope.clear();
-		m_parentScope[op_id].assign(op.m_commands.size(), -1);
+		m_eventScopes[op_id] = m_scopes.size();
 		for (size_t cmd_id = 0; cmd_id < op.m_commands.size(); ++cmd_id) {
 			const ActionLog::Command& cmd = op.m_commands[cmd_id];
-			m_parentScope[op_id][cmd_id] = scope.empty() ? -1 : scope[scope.size() - 1];
 			if (cmd.m_cmdType == ActionLog::ENTER_SCOPE) {
-				scope.push_back(cmd_id);
+				Scope s;
+				s.m_enter = cmd_id;
+				s.m_exit = op.m_commands.size() - 1;
+				s.m_parent = scope.empty() ? -1 : scope[scope.size() - 1];
+				scope.push_back(m_scopes.size());
+				m_scopes.push_back(s);
 			} else if (cmd.m_cmdType == ActionLog::EXIT_SCOPE) {
-				if (!scope.empty()) { scope.pop_back(); }
+				if (!scope.empty()) {
+					m_scopes[scope[scope.size() - 1]].m_exit = cmd_id;
+					scope.pop_back();
+				}
 			} else if (cmd.m_cmdType == ActionLog::TRIGGER_ARC) {
 				if (cmd.m_location >= 0 && cmd.m_location < static_cast<int>(m_nodeTriggerPredecessors.size())) {
 					m_nodeTriggerPredecessors[cmd.m_location] = std::pair<int, int>(op_id, cmd_id);
@@ -67,6 +75,7 @@ void CallTraceBuilder::Init(
 			}
 		}
 	}
+	m_eventScopes[log.maxEventActionId() + 1] = m_scopes.size();
 }
 
 int CallTraceBuilder::eventCreatedBy(int event_action_id) const {
@@ -82,15 +91,28 @@ bool CallTraceBuilder::getEventCreationCommand(int node_id, int* previous_node,
 	return true;
 }
 
+struct CallTraceBuilder::ScopeEnterLess {
+	bool operator()(int command_id, const Scope& scope) const {
+		return command_id < scope.m_enter;
+	}
+};
+
 void CallTraceBuilder::getCallTraceOfCommand(int event_action_id, int command_id, std::vector<int>* scope) const {
 	scope->clear();
-	if (event_action_id < 0 || event_action_id >= static_cast<int>(m_parentScope.size())) return;
-	const std::vector<int>& parents = m_parentScope[event_action_id];
-	int cmd = command_id;
-	while (cmd >= 0 && cmd < static_cast<int>(parents.size())) {
-		//if (cmd > parents[cmd]) printf("Error\n");
-		cmd = parents[cmd];
-		if (cmd >= 0) scope->push_back(cmd);
+	if (event_action_id < 0 || event_action_id + 1 >= static_cast<int>(m_eventScopes.size())) return;
+	std::vector<Scope>::const_iterator begin = m_scopes.begin() + m_eventScopes[event_action_id];
+	std::vector<Scope>::const_iterator end = m_scopes.begin() + m_eventScopes[event_action_id + 1];
+	// Only exits follow the last scope entered before the command, so the scopes open at the
+	// command are that scope or its enclosing scopes.
+	std::vector<Scope>::const_iterator last_entered =
+			std::upper_bound(begin, end, command_id - 1, ScopeEnterLess());
+	if (last_entered == begin) return;
+	int s = (last_entered - 1) - m_scopes.begin();
+	while (s >= 0 && m_scopes[s].m_exit < command_id) {
+		s = m_scopes[s].m_parent;
+	}
+	for (; s >= 0; s = m_scopes[s].m_parent) {
+		scope->push_back(m_scopes[s].m_enter);
 	}
 	std::reverse(scope->begin(), scope->end());
 }
@@ -44,7 +44,20 @@ public:
 private:
 	std::vector<int> m_causeEvent;
 	std::vector<std::pair<int, int> > m_nodeTriggerPredecessors;
-	std::vector<std::vector<int> > m_parentScope;
+	// A scope of an event action: the commands after its ENTER_SCOPE command m_enter up to
+	// and including its EXIT_SCOPE command m_exit (or the last command of the event action
+	// if the scope is not exited). m_parent is the index in m_scopes of the enclosing scope.
+	struct Scope {
+		int m_enter;
+		int m_exit;
+		int m_parent;
+	};
+	struct ScopeEnterLess;
+
+	// The scopes of event action i in the order they are entered are
+	// m_scopes[m_eventScopes[i]] to m_scopes[m_eventScopes[i + 1] - 1].
+	std::vector<Scope> m_scopes;
+	std::vector<int> m_eventScopes;
 };
 
 
@@ -20,10 +20,8 @@
 #include "EventGraph.h"
 #include "EventGraphInfo.h"
 #include "StringSet.h"
-#include "stringprintf.h"
 
-#include <map>
-#include <string>
+#include <vector>
 #include <string.h>
 
 EventGraphFixer::EventGraphFixer(
@@ -39,45 +37,34 @@ EventGraphFixer::~EventGraphFixer() {
 }
 
 void EventGraphFixer::dropNoFollowerEmptyEvents() {
-	int num_dropped_events = 0;
+	// An event is dropped if all its followers are later events that are dropped.
+	std::vector<bool> dropped(m_eventGraph->numNodes(), false);
+	std::vector<int> dropped_events;
 	for (int i = m_eventGraph->numNodes(); i > 0;) {
 		--i;
-		if (m_eventGraph->nodeSuccessors(i).size() == 0 &&
-				m_log->event_action(i).m_commands.size() == 0) {
-			m_eventGraph->deleteNode(i);
-			m_graphInfo->dropNode(i);
-			++num_dropped_events;
+		if (m_log->event_action(i).m_commands.size() != 0) continue;
+		const std::vector<int>& followers = m_eventGraph->nodeSuccessors(i);
+		bool has_follower = false;
+		for (size_t j = 0; j < followers.size(); ++j) {
+			if (followers[j] < i || !dropped[followers[j]]) {
+				has_follower = true;
+				break;
+			}
 		}
+		if (has_follower) continue;
+		dropped[i] = true;
+		dropped_events.push_back(i);
+		m_graphInfo->dropNode(i);
 	}
-	printf("Dropped %d events.\n", num_dropped_events);
-}
-
-namespace {
-bool getScriptOrResourceRunnerString(const char* varId, std::string* id) {
-	if (strncmp(varId, "CachedResource-", 15) == 0) {
-		id->assign(varId + 15);
-		return true;
-	}
-	if (strncmp(varId, "ScriptRunner-", 13) == 0) {
-		id->assign(varId + 13);
-		return true;
-	}
-	return false;
+	m_eventGraph->deleteNodes(dropped_events);
+	printf("Dropped %d events.\n", static_cast<int>(dropped_events.size()));
 }
 
-bool getTargetNodeString(const char* varId, std::string* id) {
-	if (strncmp(varId, "NodeTree:", 9) == 0) {
-		id->assign(varId + 9);
-		return true;
-	}
-	return false;
-}
-}  // namespace
-
 void EventGraphFixer::addScriptsAndResourcesHappensBefore() {
-	std::string script_id;
+	m_varClasses.update(*m_vars);
 	int num_arcs_added = 0;
-	std::map<std::string, int> m_lastLoc;
+	// The last event action that accessed each script or resource id.
+	std::vector<int> last_loc(m_varClasses.numExtractedIds(), -1);
 	for (int op_id = 0; op_id <= m_log->maxEventActionId(); ++op_id) {
 		if (m_eventGraph->isNodeDeleted(op_id)) continue;
 		const ActionLog::EventAction& op = m_log->event_action(op_id);
@@ -85,13 +72,13 @@ void EventGraphFixer::addScriptsAndResourcesHappensBefore() {
 			const ActionLog::Command& cmd = op.m_commands[i];
 			if (cmd.m_cmdType == ActionLog::WRITE_MEMORY ||
 					cmd.m_cmdType == ActionLog::READ_MEMORY) {
-				if (getScriptOrResourceRunnerString(m_vars->getString(cmd.m_location), &script_id)) {
-					std::map<std::string, int>::const_iterator it = m_lastLoc.find(script_id);
-					if (it != m_lastLoc.end()) {
-						if (m_eventGraph->addArcIfNeeded(it->second, op_id))
+				if (m_varClasses.is(cmd.m_location, LocationClasses::SCRIPT_RUNNER)) {
+					int script_id = m_varClasses.extractedId(cmd.m_location);
+					if (last_loc[script_id] != -1) {
+						if (m_eventGraph->addArcIfNeeded(last_loc[script_id], op_id))
 							++num_arcs_added;
 					}
-					m_lastLoc[script_id] = op_id;
+					last_loc[script_id] = op_id;
 				}
 			}
 		}
@@ -100,28 +87,33 @@ void EventGraphFixer::addScriptsAndResourcesHappensBefore() {
 }
 
 void EventGraphFixer::addEventAfterTargetHappensBefore() {
-	std::string node_id;
+	m_varClasses.update(*m_vars);
 	int num_arcs_added = 0;
-	std::map<std::string, int> m_lastLoc;
+	// The last event action that wrote each target node id, and the location that the
+	// accesses to the node written there are renamed to.
+	std::vector<int> last_loc(m_varClasses.numExtractedIds(), -1);
+	std::vector<int> last_loc_var(m_varClasses.numExtractedIds(), -1);
 	for (int event_action_id = 0; event_action_id <= m_log->maxEventActionId(); ++event_action_id) {
 		if (m_eventGraph->isNodeDeleted(event_action_id)) continue;
 		const ActionLog::EventAction& op = m_log->event_action(event_action_id);
 		for (size_t i = 0; i < op.m_commands.size(); ++i) {
 			const ActionLog::Command& cmd = op.m_commands[i];
 			if (cmd.m_cmdType == ActionLog::WRITE_MEMORY) {
-				if (getTargetNodeString(m_vars->getString(cmd.m_location), &node_id)) {
-					m_lastLoc[node_id] = event_action_id;
-					m_log->mutable_event_action(event_action_id)->m_commands[i].m_location =
-							m_vars->addString(StringPrintf("%s-%d", m_vars->getString(cmd.m_location), event_action_id).c_str());
+				if (m_varClasses.is(cmd.m_location, LocationClasses::NODE_TREE)) {
+					int node = m_varClasses.extractedId(cmd.m_location);
+					if (last_loc[node] != event_action_id) {
+						last_loc[node] = event_action_id;
+						last_loc_var[node] = m_vars->addDerivedString(cmd.m_location, event_action_id);
+					}
+					m_log->mutable_event_action(event_action_id)->m_commands[i].m_location = last_loc_var[node];
 				}
 			} else if (cmd.m_cmdType == ActionLog::READ_MEMORY) {
-				if (getTargetNodeString(m_vars->getString(cmd.m_location), &node_id)) {
-					std::map<std::string, int>::const_iterator it = m_lastLoc.find(node_id);
-					if (it != m_lastLoc.end()) {
-						if (m_eventGraph->addArcIfNeeded(it->second, event_action_id))
+				if (m_varClasses.is(cmd.m_location, LocationClasses::NODE_TREE)) {
+					int node = m_varClasses.extractedId(cmd.m_location);
+					if (last_loc[node] != -1) {
+						if (m_eventGraph->addArcIfNeeded(last_loc[node], event_action_id))
 							++num_arcs_added;
-						m_log->mutable_event_action(event_action_id)->m_commands[i].m_location =
-								m_vars->addString(StringPrintf("%s-%d", m_vars->getString(cmd.m_location), it->second).c_str());
+						m_log->mutable_event_action(event_action_id)->m_commands[i].m_location = last_loc_var[node];
 					}
 				}
 			}
@@ -17,6 +17,8 @@
 #ifndef GRAPHFIX_H_
 #define GRAPHFIX_H_
 
+#include "LocationClasses.h"
+
 class ActionLog;
 class SimpleDirectedGraph;
 class EventGraphInfo;
@@ -56,6 +58,7 @@ private:
 	StringSet* m_scopes;
 	SimpleDirectedGraph* m_eventGraph;
 	EventGraphInfo* m_graphInfo;
+	LocationClasses m_varClasses;
 };
 
 
@@ -16,10 +16,11 @@
 
 #include <limits.h>
 #include <algorithm>
-#include <set>
 
 #include "TimerGraph.h"
 
+#include "AnalysisProgress.h"
+
 class OrderArcs {
 public:
 	bool operator()(const ActionLog::Arc& a1, const ActionLog::Arc& a2) const {
@@ -42,23 +43,93 @@ TimerGraph::TimerGraph(const std::vector<ActionLog::Arc>& arcs, const SimpleDire
 	printf("Using %d timed arcs\n", num_timed_arcs);
 }
 
-void TimerGraph::build(SimpleDirectedGraph* graph) {
+namespace {
+// The nodes that SimpleDirectedGraph::areOrdered orders before a target: the target and
+// the earlier nodes with a path to it through earlier nodes only. The set is searched
+// backwards from the target when it is first queried and is extended for the arcs added
+// to the target.
+class OrderedBefore {
+public:
+	explicit OrderedBefore(int num_nodes)
+	    : m_target(-1), m_stamp(0), m_searched(false), m_mark(num_nodes, 0) {
+	}
+
+	void reset(int target) {
+		m_target = target;
+		++m_stamp;
+		m_searched = false;
+	}
+
+	bool contains(const SimpleDirectedGraph& graph, int node) {
+		if (!m_searched) {
+			m_searched = true;
+			add(graph, m_target);
+		}
+		return m_mark[node] == m_stamp;
+	}
+
+	// Must be called after the arc node -> target was added to the graph.
+	void addArc(const SimpleDirectedGraph& graph, int node) {
+		if (m_searched && node < m_target) add(graph, node);
+	}
+
+private:
+	void add(const SimpleDirectedGraph& graph, int node) {
+		if (m_mark[node] == m_stamp) return;
+		m_mark[node] = m_stamp;
+		m_stack.push_back(node);
+		while (!m_stack.empty()) {
+			const std::vector<int>& pred = graph.nodePredecessors(m_stack.back());
+			m_stack.pop_back();
+			for (size_t i = 0; i < pred.size(); ++i) {
+				if (pred[i] < m_target && m_mark[pred[i]] != m_stamp) {
+					m_mark[pred[i]] = m_stamp;
+					m_stack.push_back(pred[i]);
+				}
+			}
+		}
+	}
+
+	int m_target;
+	int m_stamp;
+	bool m_searched;
+	std::vector<int> m_mark;
+	std::vector<int> m_stack;
+};
+}  // namespace
+
+void TimerGraph::build(SimpleDirectedGraph* graph, AnalysisProgress* progress) {
 	std::vector<int> min_outgoing_duration(graph->numNodes(), 0x3fffffff);
 	std::vector<std::vector<int> > outgoing_arc_indices(graph->numNodes());
+	if (progress != NULL) progress->startStage("Timer graph", m_timedArcs.size());
 
+	// The visited and the covered nodes of the search for a timed arc are marked with the
+	// index of the arc.
+	std::vector<int> visited(graph->numNodes(), -1);
+	std::vector<int> covered(graph->numNodes(), -1);
+	std::vector<int> queue;
+	OrderedBefore ordered_before(graph->numNodes());
 	int num_added_arcs = 0;
 	for (size_t arci = 0; arci < m_timedArcs.size(); ++arci) {
 		const ActionLog::Arc& arc = m_timedArcs[arci];
-		if (arci % 1000 == 999) {
+		if (progress != NULL) {
+			if (!progress->check(arci)) {
+				printf("Adding timed arcs stopped after %d of %d arcs.\n",
+						static_cast<int>(arci), static_cast<int>(m_timedArcs.size()));
+				break;
+			}
+		} else if (arci % 1000 == 999) {
 			printf("Adding timed arcs %f%% done. %d arcs added.\n",
 					(arci * 100.0) / m_timedArcs.size(), num_added_arcs);
 		}
-		SimpleDirectedGraph::BFIterator it(*graph, 0x3fffffff, false);
-		it.addNode(arc.m_tail);
-		int node_id;
-
-		std::set<int> covered_arcs;
-		while (it.readNoAddFollowers(&node_id)) {
+		int mark = arci;
+		ordered_before.reset(arc.m_head);
+		// Breadth-first search backwards from the tail of the arc.
+		queue.clear();
+		queue.push_back(arc.m_tail);
+		visited[arc.m_tail] = mark;
+		for (size_t queue_pos = 0; queue_pos < queue.size(); ++queue_pos) {
+			int node_id = queue[queue_pos];
 
 			// All previous timers with lower or equal duration are before the current one.
 			if (min_outgoing_duration[node_id] <= arc.m_duration) {
@@ -66,15 +137,18 @@ void TimerGraph::build(SimpleDirectedGraph* graph) {
 				for (size_t i = node_arcs.size(); i > 0;) {
 					--i;
 					const ActionLog::Arc& prev_arc = m_timedArcs[node_arcs[i]];
-					if (it.isVisited(prev_arc.m_head)) continue;
+					if (visited[prev_arc.m_head] == mark) continue;
 					if (prev_arc.m_duration <= arc.m_duration) {
-						// TODO(veselin): This is a bit slow for the cases when there are several seconds long arcs.
-						if (covered_arcs.count(prev_arc.m_head) == 0) {
-							num_added_arcs += graph->addArcIfNeeded(prev_arc.m_head, arc.m_head);
+						if (covered[prev_arc.m_head] != mark &&
+								!ordered_before.contains(*graph, prev_arc.m_head)) {
+							graph->addArc(prev_arc.m_head, arc.m_head);
+							ordered_before.addArc(*graph, prev_arc.m_head);
+							++num_added_arcs;
+						}
+						const std::vector<int>& prev_pred = graph->nodePredecessors(prev_arc.m_head);
+						for (size_t j = 0; j < prev_pred.size(); ++j) {
+							covered[prev_pred[j]] = mark;
 						}
-						covered_arcs.insert(
-								graph->nodePredecessors(prev_arc.m_head).begin(),
-								graph->nodePredecessors(prev_arc.m_head).end());
 					}
 					if (prev_arc.m_duration == arc.m_duration) break;
 				}
@@ -85,7 +159,13 @@ void TimerGraph::build(SimpleDirectedGraph* graph) {
 			// timers with higher than the previous duration, but lower that the
 			// current duration).
 			if (min_outgoing_duration[node_id] != arc.m_duration) {
-				it.addNodeFollowers(node_id);
+				const std::vector<int>& pred = graph->nodePredecessors(node_id);
+				for (size_t j = 0; j < pred.size(); ++j) {
+					if (visited[pred[j]] != mark) {
+						visited[pred[j]] = mark;
+						queue.push_back(pred[j]);
+					}
+				}
 			}
 		}
 
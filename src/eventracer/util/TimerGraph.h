@@ -22,11 +22,15 @@
 #include "ActionLog.h"
 #include "EventGraph.h"
 
+class AnalysisProgress;
+
 class TimerGraph {
 public:
 	explicit TimerGraph(const std::vector<ActionLog::Arc>& arcs, const SimpleDirectedGraph& graph);
 
-	void build(SimpleDirectedGraph* graph);
+	// Reports to progress (if not NULL). If the analysis must stop, not all timer arcs
+	// are added to the graph.
+	void build(SimpleDirectedGraph* graph, AnalysisProgress* progress = NULL);
 
 private:
 	std::vector<ActionLog::Arc> m_timedArcs;
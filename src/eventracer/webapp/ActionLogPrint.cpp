@@ -18,21 +18,22 @@
 #include "stringprintf.h"
 
 #include "Escaping.h"
+#include "MemoryValues.h"
 
 using std::string;
 
 FunctionNamePrinter::FunctionNamePrinter(
 		const ActionLog* actions, StringSet* variables, StringSet* mem_values) {
+	MemoryValues value_table(*mem_values);
 	for (int event_action_id = 0; event_action_id <= actions->maxEventActionId();
 			++event_action_id) {
 		const ActionLog::EventAction& event = actions->event_action(event_action_id);
 		for (size_t i = 1; i < event.m_commands.size(); ++i) {
 			if ((event.m_commands[i - 1].m_cmdType == ActionLog::WRITE_MEMORY || event.m_commands[i - 1].m_cmdType == ActionLog::READ_MEMORY) &&
 					event.m_commands[i].m_cmdType == ActionLog::MEMORY_VALUE) {
-				int fn_id = 0;
-				if (sscanf(mem_values->getString(event.m_commands[i].m_location),
-						"Function[%d]", &fn_id) == 1 &&
-						m_fMap.count(fn_id) == 0) {
+				int value = event.m_commands[i].m_location;
+				if (value_table.kind(value) == MemoryValues::FUNCTION &&
+						m_fMap.count(value_table.number(value)) == 0) {
 					// A function was written to a variable for the first time.
 					std::string fn_name = variables->getString(event.m_commands[i - 1].m_location);
 					std::string::size_type dot_pos = fn_name.find('.');
@@ -40,7 +41,7 @@ FunctionNamePrinter::FunctionNamePrinter(
 						// Take only the name after the dot.
 						fn_name = fn_name.substr(dot_pos, fn_name.size() - dot_pos);
 					}
-					m_fMap[fn_id] = fn_name;
+					m_fMap[value_table.number(value)] = fn_name;
 				}
 			}
 		}
@@ -120,11 +120,13 @@ void EventGraphDisplay::outputGraph(const ActionLogPrinter* action_printer, std:
 		if (m_graphInfo->isNodeDropped(node_id)) continue;
 		addNode(action_printer, node_id);
 	}
-	for (std::set<int>::const_iterator it1 = m_includedNodes.begin();
-			it1 != m_includedNodes.end(); ++it1) {
-		for (std::set<int>::const_iterator it2 = m_includedNodes.begin();
-				it2 != m_includedNodes.end(); ++it2) {
-			addArcIfThere(*it1, *it2);
+	// The included nodes connected by paths through nodes that are not included.
+	std::vector<int> nodes(m_includedNodes.begin(), m_includedNodes.end());
+	std::vector<bool> connected;
+	m_timerGraph->areOrderedMulti(nodes, nodes, true, &connected);
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		for (size_t j = 0; j < nodes.size(); ++j) {
+			addArcIfThere(nodes[i], nodes[j], connected[i * nodes.size() + j]);
 		}
 	}
 	for (size_t i = 0; i < m_raceArcs.size(); ++i) {
@@ -180,7 +182,7 @@ void EventGraphDisplay::addNode(const ActionLogPrinter* action_printer, int node
 	}
 }
 
-void EventGraphDisplay::addArcIfThere(int source, int target) {
+void EventGraphDisplay::addArcIfThere(int source, int target, bool connected) {
 	if (source >= target) return;
 	if (m_timerGraph->hasArc(source, target)) {
 		if (m_originalGraph->hasArc(source, target)) {
@@ -192,18 +194,7 @@ void EventGraphDisplay::addArcIfThere(int source, int target) {
 		if (duration >= 0) {
 			m_graphViz.getArc(source, target)->m_duration = duration;
 		}
-	} else {
-		SimpleDirectedGraph::BFIterator it(*m_timerGraph, 0x3fffffff, true);
-		it.addNode(source);
-		int node_id;
-		while (it.readNoAddFollowers(&node_id)) {
-			if (node_id == target) {
-				m_graphViz.getArc(source, target)->m_style = "dotted";
-			}
-			if (node_id < target &&
-					(node_id == source || m_includedNodes.count(node_id) == 0)) {
-				it.addNodeFollowers(node_id);
-			}
-		}
+	} else if (connected) {
+		m_graphViz.getArc(source, target)->m_style = "dotted";
 	}
 }
@@ -61,7 +61,8 @@ public:
 private:
 	void addNode(const ActionLogPrinter* action_printer, int node_id);
 
-	void addArcIfThere(int from, int to);
+	// Adds the arc if it is in the graph, or as dotted if the nodes are connected.
+	void addArcIfThere(int from, int to, bool connected);
 
 	struct Race {
 		Race(int id, const VarsInfo::RaceInfo& info, const char* color) : m_id(id), m_varInfo(&info), m_color(color) {}
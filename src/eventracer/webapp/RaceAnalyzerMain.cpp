@@ -15,13 +15,18 @@
  */
 
 
+#include <pthread.h>
+#include <signal.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
 #include "gflags/gflags.h"
 
+#include "AnalysisProgress.h"
 #include "mongoose.h"
+#include "mutex.h"
 #include "RaceApp.h"
 
 DEFINE_string(port, "8000", "Port where the web server listens.");
@@ -33,6 +38,32 @@ namespace {
 
 RaceApp* race_app;
 
+AnalysisProgress analysis_progress;
+mutex analysis_mutex;
+bool analysis_running = true;
+
+// Waits for Ctrl-C. During the analysis, it cancels the analysis and the web server
+// shows the results found so far. Afterwards, it exits.
+void* interruptThread(void*) {
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	for (;;) {
+		int signal = 0;
+		sigwait(&signals, &signal);
+		{
+			lock_guard<mutex> lock(analysis_mutex);
+			if (analysis_running) {
+				printf("Cancelling the analysis...\n");
+				analysis_progress.cancel();
+				continue;
+			}
+		}
+		exit(0);
+	}
+	return NULL;
+}
+
 static int request_handler(struct mg_connection *conn) {
 	const struct mg_request_info *request_info = mg_get_request_info(conn);
 
@@ -106,8 +137,21 @@ int main(int argc, char* argv[]) {
 		return 1;
 	}
 
+	// SIGINT is only handled by the interrupt thread, which can safely cancel the analysis.
+	// The threads started later inherit the blocked signal.
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	pthread_sigmask(SIG_BLOCK, &signals, NULL);
+	pthread_t interrupt_thread;
+	pthread_create(&interrupt_thread, NULL, &interruptThread, NULL);
+
 	// Creating a race app.
-    race_app = new RaceApp(0, argv[1], FLAGS_drop_node_analysis);
+	race_app = new RaceApp(0, argv[1], FLAGS_drop_node_analysis, &analysis_progress);
+	{
+		lock_guard<mutex> lock(analysis_mutex);
+		analysis_running = false;
+	}
 
 	// Start the web server.
 	ctx = mg_start(&callbacks, NULL, options);
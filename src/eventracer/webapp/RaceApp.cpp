@@ -49,6 +49,9 @@ DEFINE_string(race_filter_ignore_loc, "",
         "Ignore specific locations from the analysis. Multiple locations are given as a comma separated list.");
 DEFINE_string(commutative_lazy_init_locs, "",
         "Filter commutative operations, caused by lazy init of the form of x = x || ? on the location x, from the analysis. The given location must be a suffix of the matched location. Multiple locations are given as a comma separated list.");
+DEFINE_bool(precompute_race_hierarchy, true,
+        "Compute the direct child races of all races in a background thread after race detection.");
+DECLARE_int32(bfs_query_cache_size);
 
 using std::string;
 
@@ -154,10 +157,14 @@ const char* VarTypeByName(const char* name) {
 // End utility
 }  // namespace
 
-RaceApp::RaceApp(int64 app_id, const std::string& actionLogFile, bool can_drop_nodes)
+RaceApp::RaceApp(int64 app_id, const std::string& actionLogFile, bool can_drop_nodes,
+		AnalysisProgress* progress)
 	: m_appId(app_id),
 	  m_raceTags(m_vinfo, m_actions, m_vars, m_scopes, m_memValues, m_callTraceBuilder),
 	  m_fileName(actionLogFile) {
+	if (progress != NULL) {
+		m_vinfo.setProgress(progress);
+	}
 	fprintf(stderr, "Loading %s... ", actionLogFile.c_str());
 	FILE* f = fopen(actionLogFile.c_str(), "rb");
 	if (!f) {
@@ -183,21 +190,21 @@ RaceApp::RaceApp(int64 app_id, const std::string& actionLogFile, bool can_drop_n
 
     if (FLAGS_use_race_filters) {
 
-        std::stringstream ignored_locs(FLAGS_race_filter_ignore_loc);
+        std::vector<std::string> ignored_locs;
+        std::stringstream ignored_locs_stream(FLAGS_race_filter_ignore_loc);
         std::string ignored_loc;
-        while (std::getline(ignored_locs, ignored_loc, ',')) {
-            preprocess.IgnoreLocation(ignored_loc);
+        while (std::getline(ignored_locs_stream, ignored_loc, ',')) {
+            ignored_locs.push_back(ignored_loc);
         }
 
-        std::stringstream commutative_lazy_init_locs(FLAGS_commutative_lazy_init_locs);
+        std::vector<std::string> commutative_lazy_init_locs;
+        std::stringstream commutative_lazy_init_locs_stream(FLAGS_commutative_lazy_init_locs);
         std::string commutative_lazy_init_loc;
-        while (std::getline(commutative_lazy_init_locs, commutative_lazy_init_loc, ',')) {
-            preprocess.RemoveCommutativeLazyInit(commutative_lazy_init_loc);
+        while (std::getline(commutative_lazy_init_locs_stream, commutative_lazy_init_loc, ',')) {
+            commutative_lazy_init_locs.push_back(commutative_lazy_init_loc);
         }
 
-        preprocess.RemoveGlobalLocals();
-        preprocess.RemovePureIncrementation();
-        preprocess.RemoveConstantValue();
+        preprocess.RemovePatterns(ignored_locs, commutative_lazy_init_locs);
         //preprocess.RemoveEmptyReadWrites();
         //preprocess.RemoveNopWrites();
         //preprocess.RemoveUpdatesInSameMethod();
@@ -207,40 +214,58 @@ RaceApp::RaceApp(int64 app_id, const std::string& actionLogFile, bool can_drop_n
 
 	m_inputEventGraph.addNodesUpTo(m_actions.maxEventActionId());
 	int num_arcs = 0;
+	std::vector<std::pair<int, int> > arcs;
+	arcs.reserve(m_actions.arcs().size());
 	for (size_t i = 0; i < m_actions.arcs().size(); ++i) {
 		const ActionLog::Arc& arc = m_actions.arcs()[i];
 		if (arc.m_tail > arc.m_head) {
 			fprintf(stderr, "Unexpected backwards arc %d -> %d\n", arc.m_tail, arc.m_head);
 		}
-		m_inputEventGraph.addArc(arc.m_tail, arc.m_head);
+		arcs.push_back(std::make_pair(arc.m_tail, arc.m_head));
 		++num_arcs;
 	}
+	m_inputEventGraph.addArcs(arcs);
 	printf("Created graph with %d nodes, %d arcs.\n",
 			m_inputEventGraph.numNodes(), num_arcs);
 
 	m_callTraceBuilder.Init(m_actions, m_inputEventGraph);
 
 	m_graphInfo.init(m_actions);
+	// The fixer and the timers graph add arcs only if the graph does not order their
+	// ends yet. The cache keeps these searches while the graph grows.
+	m_inputEventGraph.setQueryCacheSize(FLAGS_bfs_query_cache_size);
 	EventGraphFixer fixer(&m_actions, &m_vars, &m_scopes, &m_inputEventGraph, &m_graphInfo);
 	if (can_drop_nodes) { fixer.dropNoFollowerEmptyEvents(); }
 	fixer.makeIndependentEventExploration();
 	fixer.addScriptsAndResourcesHappensBefore();
 	fixer.addEventAfterTargetHappensBefore();
+	// The request handlers read the variable names from several threads.
+	m_vars.materializeDerivedStrings();
+	// The cache only pays off while the graph grows.
+	m_inputEventGraph.setQueryCacheSize(0);
 	m_vinfo.init(m_actions);
 	printf("All variables loaded.\n");
 
 	printf("Building timers graph...\n");
 	int64 start_time = GetCurrentTimeMicros();
+	// The timers graph is built within the time budget of the race detection.
+	m_vinfo.startTimeBudget();
 	m_graphWithTimers = m_inputEventGraph;
+	m_graphWithTimers.setQueryCacheSize(FLAGS_bfs_query_cache_size);
 	TimerGraph timerg(m_actions.arcs(), m_graphWithTimers);
-	timerg.build(&m_graphWithTimers);
+	timerg.build(&m_graphWithTimers, m_vinfo.progress());
+	m_graphWithTimers.setQueryCacheSize(0);
 	printf("Timers graph done (%lld ms).\n", (GetCurrentTimeMicros() - start_time) / 1000);
 
 	printf("Checking for races...\n");
 	start_time = GetCurrentTimeMicros();
 	m_vinfo.findRaces(m_actions, m_graphWithTimers);
 	printf("Done checking for races (%lld ms)...\n", (GetCurrentTimeMicros() - start_time) / 1000);
+	if (FLAGS_precompute_race_hierarchy) {
+		m_vinfo.startRaceHierarchyBuild();
+	}
 
+	m_raceTags.Init();
 	m_actionPrinter = new ActionLogPrinter(&m_actions, &m_vars, &m_scopes, &m_memValues);
 }
 
@@ -280,6 +305,31 @@ void RaceApp::handleInfo(const std::string& params, std::string* response) {
 			"<p>Finally, one can search by memory location name.</p></div>",
 			HTMLEscape(m_fileName).c_str(),
 			m_vars.numEntries(), m_actions.maxEventActionId());
+	if (m_vinfo.timedOut()) {
+		response->append(
+				"<p><b>Warning:</b> The race detection timed out or was cancelled. Only the races "
+				"found until then are shown and some of them are shown as uncovered even if "
+				"they may be covered.</p>");
+	}
+	if (m_vinfo.raceWindow() > 0) {
+		StringAppendF(response,
+				"<p><b>Note:</b> Only the races between event actions at most %d event actions "
+				"apart were searched for (race window). The reads and writes of the memory "
+				"locations were not kept, so the tags that depend on them are not shown.</p>",
+				m_vinfo.raceWindow());
+	}
+	if (m_vinfo.samplingFraction() < 1.0) {
+		StringAppendF(response,
+				"<p><b>Note:</b> Only a random sample of %d memory locations was searched for races. "
+				"%d memory locations were skipped:</p><p>",
+				static_cast<int>(m_vinfo.variables().size()),
+				static_cast<int>(m_vinfo.skippedVars().size()));
+		for (std::set<int>::const_iterator it = m_vinfo.skippedVars().begin();
+				it != m_vinfo.skippedVars().end(); ++it) {
+			StringAppendF(response, "%s ", HTMLEscape(m_vars.getString(*it)).c_str());
+		}
+		response->append("</p>");
+	}
 	displaySearchBox("", 0, response);
 
 	addFooter(response);
@@ -1003,6 +1053,9 @@ void RaceApp::showRaceInfo(int race_id, std::string* response) const {
 	const VarsInfo::RaceInfo& race = m_vinfo.races()[race_id];
 	StringAppendF(response, "<p>Race id #%d ; ", race_id);
 	showRaceLink(race_id, response);
+	if (!race.m_coverageChecked) {
+		response->append(" - Coverage not checked");
+	}
 	if (race.m_coveredBy == -1) {
 		if (race.m_multiParentRaces.empty()) {
 			response->append(" - Uncovered race");
@@ -29,13 +29,17 @@
 #include "RaceTags.h"
 
 class ActionLogPrinter;
+class AnalysisProgress;
 class EventGraphDisplay;
 class URLParams;
 class CodeOutput;
 
 class RaceApp {
 public:
-	RaceApp(int64 app_id, const std::string& actionLogFile, bool can_drop_nodes);
+	// If progress is not NULL, the analysis reports to it and can be cancelled with it
+	// from another thread. The progress must outlive the RaceApp.
+	RaceApp(int64 app_id, const std::string& actionLogFile, bool can_drop_nodes,
+			AnalysisProgress* progress = NULL);
 	~RaceApp();
 
 	void handleInfo(const std::string& params, std::string* response);
@@ -21,6 +21,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <map>
+#include <set>
+#include <utility>
 
 #include "file.h"
 
@@ -122,6 +124,15 @@ bool TraceReorder::GetScheduleFromRace(
     bprimeprime.push_back(m_schedule[schedule_pos]);
     ++schedule_pos;
 
+    // The (event1, event2) pairs of all races.
+    std::set<std::pair<int, int> > race_events;
+    const VarsInfo::AllRaces& races = vinfo.races();
+    for (VarsInfo::AllRaces::const_iterator it = races.begin(); it != races.end(); ++it) {
+        race_events.insert(std::make_pair(it->m_event1, it->m_event2));
+    }
+    std::vector<EventGraphInterface::OrderQuery> queries;
+    std::vector<bool> ordered;
+
     // Emit b' until we see y
 
     for (; schedule_pos < m_schedule.size() && m_schedule[schedule_pos] != race.m_event2; ++schedule_pos) {
@@ -134,24 +145,16 @@ bool TraceReorder::GetScheduleFromRace(
 
         bool depends = false;
 
+        // happens before, checked for all of b'' at once
+        queries.clear();
         for (size_t i = 0; i < bprimeprime.size(); ++i) {
+            queries.push_back(EventGraphInterface::OrderQuery(bprimeprime[i], m_schedule[schedule_pos]));
+        }
+        hb->areOrderedBatch(queries, &ordered);
 
-            // happens before
-            if (hb->areOrdered(bprimeprime[i], m_schedule[schedule_pos])) {
-                depends = true;
-                break;
-            }
-
-            // races
-            const VarsInfo::AllRaces& races = vinfo.races();
-            VarsInfo::AllRaces::const_iterator it = races.begin();
-            for (; it != races.end(); ++it) {
-                if (it->m_event1 == bprimeprime[i] && it->m_event2 == m_schedule[schedule_pos]) {
-                    depends = true;
-                    break;
-                }
-            }
-
+        for (size_t i = 0; i < bprimeprime.size() && !depends; ++i) {
+            depends = ordered[i] ||
+                    race_events.count(std::make_pair(bprimeprime[i], m_schedule[schedule_pos])) != 0;
         }
 
         if (depends) {